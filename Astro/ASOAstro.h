@@ -57,6 +57,13 @@ typedef NS_ENUM(NSUInteger, ASOLunarPhaseType) {
     ASOLunarPhaseTypeWaxingGibbous = 7,
 } NS_SWIFT_NAME(LunarPhaseType);
 
+// precision traded for speed, ACC_* in astro.h
+typedef NS_ENUM(NSUInteger, ASOAccuracy) {
+    ASOAccuracyFull = 0,        // complete series
+    ASOAccuracyStandard = 1,    // about an arc second, 1.5 times faster
+    ASOAccuracyDisplay = 2,     // about an arc minute, 3 times faster
+} NS_SWIFT_NAME(Accuracy);
+
 NS_SWIFT_SENDABLE
 NS_SWIFT_NAME(LunarPhase)
 @interface ASOLunarPhase : NSObject
@@ -68,6 +75,13 @@ NS_SWIFT_NAME(LunarPhase)
 @property (nonatomic, readonly) BOOL isFirstHalf;
 @end
 
+NS_SWIFT_SENDABLE
+NS_SWIFT_NAME(LunarPhaseEvent)
+@interface ASOLunarPhaseEvent : NSObject
+@property (nonatomic, readonly) NSDate *time;
+@property (nonatomic, readonly) ASOLunarPhaseType phaseType;
+@end
+
 NS_SWIFT_SENDABLE
 NS_SWIFT_NAME(SatellitePass)
 @interface ASOSatellitePass : NSObject
@@ -117,6 +131,25 @@ NS_SWIFT_NAME(SunTime)
 @property (readonly) NSTimeInterval endTIme;
 @end
 
+// one day of an almanac; events the day does not have are nil
+NS_SWIFT_SENDABLE
+NS_SWIFT_NAME(AlmanacDay)
+@interface ASOAlmanacDay : NSObject
+@property (nonatomic, readonly) NSDate *start;
+@property (nullable, nonatomic, readonly) ASOAstroPosition *sunRise;
+@property (nullable, nonatomic, readonly) ASOAstroPosition *sunSet;
+@property (nullable, nonatomic, readonly) ASOAstroPosition *sunTransit;
+@property (nullable, nonatomic, readonly) NSDate *civilDawn;
+@property (nullable, nonatomic, readonly) NSDate *civilDusk;
+@property (nullable, nonatomic, readonly) NSDate *nauticalDawn;
+@property (nullable, nonatomic, readonly) NSDate *nauticalDusk;
+@property (nullable, nonatomic, readonly) NSDate *astronomicalDawn;
+@property (nullable, nonatomic, readonly) NSDate *astronomicalDusk;
+@property (nullable, nonatomic, readonly) ASOAstroPosition *moonRise;
+@property (nullable, nonatomic, readonly) ASOAstroPosition *moonSet;
+@property (nullable, nonatomic, readonly) ASOAstroPosition *moonTransit;
+@end
+
 NS_SWIFT_NAME(Astro)
 @interface ASOAstro : NSObject
 
@@ -125,6 +158,7 @@ NS_SWIFT_NAME(Astro)
 + (ASOLunarPhase *)moonPhaseAtTime:(NSDate *)time;
 + (ASOAstroRiset *)objectRisetInLocation:(double)longitude latitude:(double)latitude altitude:(double)altitude forTime:(NSDate *)time objectIndex:(NSInteger)index up:(BOOL)up;
 + (void)risetInLocation:(double)longitude latitude:(double)latitude altitude:(double)altitude forTime:(NSDate *)time completion:(nullable void (^)(ASOAstroRiset *sun, ASOAstroRiset * moon))handler;
++ (NSArray<ASOLunarPhaseEvent *> *)moonPhaseEventsFrom:(NSDate *)startTime to:(NSDate *)endTime;
 + (NSArray<ASOAstroRiset *>*)risetForSolarSystemObjectsInLongitude:(double)longitude latitude:(double)latitude altitude: (double)altitude forTime:(NSDate *)time up:(BOOL)up;
 + (ASOStarRiset *)risetForStarWithRA:(double)ra dec:(double)dec longitude:(double)longitude latitude:(double)latitude time:(NSDate *)time;
 + (double)getLSTInLocation:(double)longitude time:(NSDate *)time;
@@ -133,9 +167,24 @@ NS_SWIFT_NAME(Astro)
 + (nullable ASOSatellitePass *)getSatelliteNextRiset:(ASOSatelliteTLE *)tle atTime:(NSDate *)time longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude;
 + (ASOAstroPosition *)getStarPosition:(double)ra dec:(double)dec raPm:(double)raPm decPm:(double)decPM time:(NSDate *)time longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude;
 + (ASOAstroPosition *)getSolarSystemObjectPosition:(NSInteger)index time:(NSDate *)time longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude;
++ (NSArray<ASOAstroPosition *> *)getSolarSystemObjectPositions:(NSInteger)index times:(NSArray<NSDate *> *)times longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude;
 + (nullable ASOAstroPosition *)getSatellitePosition:(ASOSatelliteTLE *)tle time:(NSDate *)time longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude;
 + (NSArray<ASOSunTime *> *)getSunTimes:(NSDate *)startTime endTime:(NSDate *)endTime longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude;
 
+// the sun, twilight and moon events of days days from startTime, each day
+// 24 hours on from the one before
++ (NSArray<ASOAlmanacDay *> *)almanacFrom:(NSDate *)startTime days:(NSInteger)days longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude;
+
+// instrumentation over all threads since the last resetStats, all zero unless
+// the library was built with ASTRO_STATS. call counts by name, and for each
+// timed entry point a log2 histogram of its call times in nanoseconds
++ (NSDictionary<NSString *, NSNumber *> *)statCounts;
++ (NSDictionary<NSString *, NSArray<NSNumber *> *> *)statHistograms;
++ (void)resetStats;
+
+// accuracy of everything computed from now on, on every thread
++ (void)setAccuracy:(ASOAccuracy)accuracy;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -48,6 +48,12 @@ double ModifiedJulianDate(NSDate *time)
 
 @end
 
+@interface ASOSatelliteTLE () {
+    SatelliteHandle *_handle;
+}
+@property (nonatomic, readonly, nullable) const SatelliteHandle *handle;
+@end
+
 @implementation ASOSatelliteTLE : NSObject
 - (instancetype)initWithLine0: (NSString *)line0 line1: (NSString *)line1 line2: (NSString *)line2 {
     self = [super init];
@@ -55,9 +61,18 @@ double ModifiedJulianDate(NSDate *time)
         _line0 = line0;
         _line1 = line1;
         _line2 = line2;
+        _handle = CreateSatelliteHandle([line0 UTF8String], [line1 UTF8String], [line2 UTF8String]);
     }
     return self;
 }
+
+- (nullable const SatelliteHandle *)handle {
+    return _handle;
+}
+
+- (void)dealloc {
+    DestroySatelliteHandle(_handle);
+}
 @end
 
 @implementation ASOSatelliteStatus : NSObject
@@ -72,6 +87,17 @@ double ModifiedJulianDate(NSDate *time)
 }
 @end
 
+@implementation ASOLunarPhaseEvent
+- (instancetype)initWithTime:(NSDate *)time phaseType:(ASOLunarPhaseType)phaseType {
+    self = [super init];
+    if (self) {
+        _time = time;
+        _phaseType = phaseType;
+    }
+    return self;
+}
+@end
+
 @implementation ASOLunarPhase
 - (instancetype)initWithPhase:(double)phase isFirstHalf:(BOOL)isFirstHalf nextNewMoon:(NSDate *)nextNew nextFullMoon:(NSDate *)nextFull {
     self = [super init];
@@ -116,7 +142,7 @@ double ModifiedJulianDate(NSDate *time)
 
 @implementation ASOSatellitePass
 
-- (instancetype)initWithRise:(ASOAstroPosition *)rise set:(ASOAstroPosition *)set peak:(ASOAstroPosition *)peak visibleRise:(nullable ASOAstroPosition *)visibleRise  visibleSet:(nullable ASOAstroPosition *)visibleSet {
+- (instancetype)initWithRise:(ASOAstroPosition *)rise set:(ASOAstroPosition *)set peak:(ASOAstroPosition *)peak visibleRise:(nullable ASOAstroPosition *)visibleRise visibleSet:(nullable ASOAstroPosition *)visibleSet visiblePeak:(nullable ASOAstroPosition *)visiblePeak {
     self = [super init];
     if (self) {
         _rise = rise;
@@ -124,15 +150,7 @@ double ModifiedJulianDate(NSDate *time)
         _peak = peak;
         _visibleRise = visibleRise;
         _visibleSet = visibleSet;
-        if (visibleRise && visibleSet) {
-            if ([[peak time] timeIntervalSince1970] < [[visibleRise time] timeIntervalSince1970] || [[peak time] timeIntervalSince1970] > [[visibleSet time] timeIntervalSince1970]) {
-                _visiblePeak = [visibleRise elevation] > [visibleSet elevation] ? visibleRise : visibleSet;
-            } else  {
-                _visiblePeak = peak;
-            }
-        } else {
-            _visiblePeak = nil;
-        }
+        _visiblePeak = visiblePeak;
     }
     return self;
 }
@@ -167,6 +185,39 @@ double ModifiedJulianDate(NSDate *time)
 }
 @end
 
+static NSDate *_Nullable AlmanacDate(double time)
+{
+    return time ? [NSDate dateWithTimeIntervalSince1970:time] : nil;
+}
+
+static ASOAstroPosition *_Nullable AlmanacPosition(double time, double azimuth, double elevation)
+{
+    return time ? [[ASOAstroPosition alloc] initWithAzimuth:azimuth elevation:elevation time:[NSDate dateWithTimeIntervalSince1970:time]] : nil;
+}
+
+@implementation ASOAlmanacDay
+
+- (instancetype)initWithDay:(const AlmanacDay &)day {
+    self = [super init];
+    if (self) {
+        _start = [NSDate dateWithTimeIntervalSince1970:day.start];
+        _sunRise = AlmanacPosition(day.sunRise, day.sunRiseAzimuth, 0);
+        _sunSet = AlmanacPosition(day.sunSet, day.sunSetAzimuth, 0);
+        _sunTransit = AlmanacPosition(day.sunTransit, day.sunTransitAzimuth, day.sunTransitAltitude);
+        _civilDawn = AlmanacDate(day.civilDawn);
+        _civilDusk = AlmanacDate(day.civilDusk);
+        _nauticalDawn = AlmanacDate(day.nauticalDawn);
+        _nauticalDusk = AlmanacDate(day.nauticalDusk);
+        _astronomicalDawn = AlmanacDate(day.astronomicalDawn);
+        _astronomicalDusk = AlmanacDate(day.astronomicalDusk);
+        _moonRise = AlmanacPosition(day.moonRise, day.moonRiseAzimuth, 0);
+        _moonSet = AlmanacPosition(day.moonSet, day.moonSetAzimuth, 0);
+        _moonTransit = AlmanacPosition(day.moonTransit, day.moonTransitAzimuth, day.moonTransitAltitude);
+    }
+    return self;
+}
+@end
+
 @implementation ASOAstro
 
 + (ASOAstroRiset *)objectRisetInLocation:(double)longitude latitude:(double)latitude altitude:(double)altitude forTime:(NSDate *)time objectIndex:(NSInteger)index up:(BOOL)up {
@@ -205,15 +256,23 @@ double ModifiedJulianDate(NSDate *time)
 }
 
 + (ASOLunarPhase *)moonPhaseAtTime:(NSDate *)time {
-    NSDate *prevNew =  [NSDate dateWithTimeIntervalSince1970:FindMoonPhase([time timeIntervalSince1970], M_PI * -2, 0)];
-    NSDate *nextNew = [NSDate dateWithTimeIntervalSince1970:FindMoonPhase([time timeIntervalSince1970], M_PI * 2, 0)];
-    NSDate *nextFull = [NSDate dateWithTimeIntervalSince1970:FindMoonPhase([time timeIntervalSince1970], M_PI * 2, M_PI)];
-    NSDate *prevNextFull = [NSDate dateWithTimeIntervalSince1970:FindMoonPhase([prevNew timeIntervalSince1970], M_PI * 2, M_PI)];
+    NSDate *prevNew =  [NSDate dateWithTimeIntervalSince1970:FindMoonPhaseEvent([time timeIntervalSince1970], MOON_PHASE_NEW, false)];
+    NSDate *nextNew = [NSDate dateWithTimeIntervalSince1970:FindMoonPhaseEvent([time timeIntervalSince1970], MOON_PHASE_NEW, true)];
+    NSDate *nextFull = [NSDate dateWithTimeIntervalSince1970:FindMoonPhaseEvent([time timeIntervalSince1970], MOON_PHASE_FULL, true)];
+    NSDate *prevNextFull = [NSDate dateWithTimeIntervalSince1970:FindMoonPhaseEvent([prevNew timeIntervalSince1970], MOON_PHASE_FULL, true)];
     double phase = CurrentMoonPhase([time timeIntervalSince1970]);
 
     return [[ASOLunarPhase alloc] initWithPhase:phase isFirstHalf:[time timeIntervalSinceDate:prevNextFull] <= 0 nextNewMoon:nextNew nextFullMoon:nextFull];
 }
 
++ (NSArray<ASOLunarPhaseEvent *> *)moonPhaseEventsFrom:(NSDate *)startTime to:(NSDate *)endTime {
+    auto events = GetMoonPhaseEvents([startTime timeIntervalSince1970], [endTime timeIntervalSince1970]);
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:events.size()];
+    for (auto event : events)
+        [array addObject:[[ASOLunarPhaseEvent alloc] initWithTime:[NSDate dateWithTimeIntervalSince1970:event.time] phaseType:(ASOLunarPhaseType)event.phase]];
+    return array;
+}
+
 + (NSArray *)risetForSolarSystemObjectsInLongitude:(double)longitude latitude:(double) latitude altitude:(double)altitude forTime:(NSDate *)time up:(BOOL)up {
     NSMutableArray *array = [NSMutableArray array];
     for (int i = MERCURY; i <= MOON; i++) {
@@ -261,7 +320,9 @@ double ModifiedJulianDate(NSDate *time)
 
 + (nullable ASOSatelliteStatus *)getSatelliteStatus:(ASOSatelliteTLE *)tle atTime:(NSDate *)time {
     double sublng, sublat, elevation;
-    int result = GetSatelliteStatus([[tle line0] UTF8String], [[tle line1] UTF8String], [[tle line2] UTF8String], [time timeIntervalSince1970], &sublng, &sublat, &elevation);
+    if (!tle.handle)
+        return nil;
+    int result = GetSatelliteStatus(tle.handle, [time timeIntervalSince1970], &sublng, &sublat, &elevation);
 
     if (result) {
         return [[ASOSatelliteStatus alloc] initWithSubLongitude:sublng subLatitude:sublat elevation:elevation];
@@ -273,7 +334,9 @@ double ModifiedJulianDate(NSDate *time)
     RiseSet riset;
     RiseSet visibleRiset;
     double visibleRiseAlt, visibleSetAlt;
-    int result = GetNextSatellitePass([[tle line0] UTF8String], [[tle line1] UTF8String], [[tle line2] UTF8String], [time timeIntervalSince1970], longitude, latitude, altitude, &riset, &visibleRiset, &visibleRiseAlt, &visibleSetAlt);
+    if (!tle.handle)
+        return nil;
+    int result = GetNextSatellitePass(tle.handle, [time timeIntervalSince1970], longitude, latitude, altitude, &riset, &visibleRiset, &visibleRiseAlt, &visibleSetAlt);
     if (result != 0)
         return nil;
 
@@ -283,13 +346,15 @@ double ModifiedJulianDate(NSDate *time)
 
     ASOAstroPosition *visibleRise = nil;
     ASOAstroPosition *visibleSet = nil;
+    ASOAstroPosition *visiblePeak = nil;
 
     if (visibleRiset.rs_flags == 0)
     {
         visibleRise = [[ASOAstroPosition alloc] initWithAzimuth:visibleRiset.rs_riseaz elevation:visibleRiseAlt time:ModernDate(visibleRiset.rs_risetm)];
         visibleSet = [[ASOAstroPosition alloc] initWithAzimuth:visibleRiset.rs_setaz elevation:visibleSetAlt time:ModernDate(visibleRiset.rs_settm)];
+        visiblePeak = [[ASOAstroPosition alloc] initWithAzimuth:visibleRiset.rs_tranaz elevation:visibleRiset.rs_tranalt time:ModernDate(visibleRiset.rs_trantm)];
     }
-    return [[ASOSatellitePass alloc] initWithRise:rise set:set peak:peak visibleRise:visibleRise visibleSet:visibleSet];
+    return [[ASOSatellitePass alloc] initWithRise:rise set:set peak:peak visibleRise:visibleRise visibleSet:visibleSet visiblePeak:visiblePeak];
 }
 
 + (ASOAstroPosition *)getStarPosition:(double)ra dec:(double)dec raPm:(double)raPm decPm:(double)decPM time:(NSDate *)time longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude {
@@ -320,9 +385,29 @@ double ModifiedJulianDate(NSDate *time)
     return [[ASOAstroPosition alloc] initWithAzimuth:(double)obj.any.co_az elevation:(double)obj.any.co_alt time:time];
 }
 
++ (NSArray<ASOAstroPosition *> *)getSolarSystemObjectPositions:(NSInteger)index times:(NSArray<NSDate *> *)times longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude {
+    int count = (int)times.count;
+    int objectIndex = (int)index;
+    std::vector<double> seconds(count), el(count), az(count);
+    for (int i = 0; i < count; i++)
+        seconds[i] = [times[i] timeIntervalSince1970];
+
+    SkyPositions positions = {};
+    positions.alt = el.data();
+    positions.az = az.data();
+    GetSkyPositions(&objectIndex, 1, seconds.data(), count, longitude, latitude, altitude, &positions);
+
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:count];
+    for (int i = 0; i < count; i++)
+        [array addObject:[[ASOAstroPosition alloc] initWithAzimuth:az[i] elevation:el[i] time:times[i]]];
+    return array;
+}
+
 + (ASOAstroPosition *)getSatellitePosition:(ASOSatelliteTLE *)tle time:(NSDate *)time longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude {
     double el, az;
-    int result = GetSatellitePosition([[tle line0] UTF8String], [[tle line1] UTF8String], [[tle line2] UTF8String], longitude, latitude, altitude, [time timeIntervalSince1970], &el, &az);
+    if (!tle.handle)
+        return nil;
+    int result = GetSatellitePosition(tle.handle, longitude, latitude, altitude, [time timeIntervalSince1970], &el, &az);
 
     if (result) {
         return [[ASOAstroPosition alloc] initWithAzimuth:az elevation:el time:time];
@@ -342,4 +427,42 @@ double ModifiedJulianDate(NSDate *time)
     return [array copy];
 }
 
++ (NSArray<ASOAlmanacDay *> *)almanacFrom:(NSDate *)startTime days:(NSInteger)days longitude:(double)longitude latitude:(double)latitude altitude:(double)altitude {
+    auto almanac = GetAlmanac(longitude, latitude, altitude, [startTime timeIntervalSince1970], (int)days);
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:almanac.size()];
+    for (const auto &day : almanac)
+        [array addObject:[[ASOAlmanacDay alloc] initWithDay:day]];
+    return [array copy];
+}
+
++ (NSDictionary<NSString *, NSNumber *> *)statCounts {
+    AstroStats stats;
+    stats_snapshot(&stats);
+    NSMutableDictionary *counts = [NSMutableDictionary dictionaryWithCapacity:NSTATCOUNTS];
+    for (int i = 0; i < NSTATCOUNTS; i++)
+        counts[@(stats_count_name(i))] = @(stats.st_count[i]);
+    return [counts copy];
+}
+
++ (NSDictionary<NSString *, NSArray<NSNumber *> *> *)statHistograms {
+    AstroStats stats;
+    stats_snapshot(&stats);
+    NSMutableDictionary *histograms = [NSMutableDictionary dictionaryWithCapacity:NSTATTIMERS];
+    for (int t = 0; t < NSTATTIMERS; t++) {
+        NSMutableArray *buckets = [NSMutableArray arrayWithCapacity:STAT_NBUCKETS];
+        for (int i = 0; i < STAT_NBUCKETS; i++)
+            [buckets addObject:@(stats.st_hist[t][i])];
+        histograms[@(stats_timer_name(t))] = [buckets copy];
+    }
+    return [histograms copy];
+}
+
++ (void)resetStats {
+    stats_reset();
+}
+
++ (void)setAccuracy:(ASOAccuracy)accuracy {
+    astro_setaccuracy((int)accuracy);
+}
+
 @end
@@ -3,10 +3,16 @@
 //
 
 #include "astro_common.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
 #include <cstring>
 #include <cmath>
 #include <ctime>
 #include <iostream>
+#include <mutex>
+#include <system_error>
+#include <thread>
 #include <utility>
 
 #define EPHEM_SECONDS_DIFFERENCE   2209032000
@@ -17,6 +23,23 @@
 
 using namespace std;
 
+#ifdef ASTRO_STATS
+/* adds the time from here to the end of the scope to timer's histogram */
+class StatTimer
+{
+public:
+    StatTimer(int timer) : timer(timer), start(stats_clock()) {}
+    ~StatTimer() { stats_time(timer, stats_clock() - start); }
+
+private:
+    int timer;
+    unsigned long long start;
+};
+#define STAT_TIMER(t)   StatTimer statTimer(t)
+#else
+#define STAT_TIMER(t)
+#endif
+
 static const char *planetNames[] = {
         "Mercury",
         "Venus",
@@ -143,27 +166,546 @@ int FindAlt0(Now *now, Obj *obj, double step, double limit, int forward, int go_
     return FindAltX(now, obj, step, limit, forward, go_down, az, jd, transit_az, transit_al, transit_tm, 0);
 }
 
-int FindAltXSun(Now *now, double step, double limit, int forward, int go_down, double *jd, double x)
+#define CROSSING_TOLERANCE  (0.1 / SECONDS_PER_DAY)
+#define TRANSIT_TOLERANCE   (10.0 / SECONDS_PER_DAY)
+
+/* altitude of obj at time, evaluated on a scratch copy so obj stays untouched */
+static double AltitudeAt(Now *now, Obj *obj, double time, double *az)
+{
+    Obj current;
+    memcpy(&current, obj, sizeof(Obj));
+
+    now->n_mjd = time;
+    obj_cir(now, &current);
+
+    if (az)
+        *az = current.any.co_az;
+    return current.any.co_alt;
+}
+
+/* upper bound of |d alt / dt| in rad/day: the diurnal rotation seen from the
+ * observer's latitude plus the object's own motion. refraction a few degrees
+ * below the horizon can stretch the apparent rate up to ~2.4x the true one,
+ * hence the safety factor.
+ */
+static double MaxAltitudeRate(Now *now, Obj *obj)
+{
+    double own = 0;
+    if (obj->o_type == PLANET)
+        own = obj->pl.plo_code == MOON ? 0.4 : 0.05;
+    return 2.5 * (2 * M_PI / SIDRATE * fabs(cos(now->n_lat)) + own);
+}
+
+/* Brent's method on f inside [a, b], whose ends bracket a root */
+template <typename F>
+static double BrentRoot(F f, double a, double fa, double b, double fb)
+{
+    double c = b, fc = fb;
+    double d = b - a, e = d;
+
+    for (int iter = 0; iter < 100; iter++)
+    {
+        if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0))
+        {
+            c = a;
+            fc = fa;
+            e = d = b - a;
+        }
+        if (fabs(fc) < fabs(fb))
+        {
+            a = b; fa = fb;
+            b = c; fb = fc;
+            c = a; fc = fa;
+        }
+
+        double tol = 2 * DBL_EPSILON * fabs(b) + 0.5 * CROSSING_TOLERANCE;
+        double xm = 0.5 * (c - b);
+        if (fabs(xm) <= tol || fb == 0)
+            break;
+
+        if (fabs(e) >= tol && fabs(fa) > fabs(fb))
+        {
+            double p, q, r;
+            double s = fb / fa;
+            if (a == c)
+            {
+                p = 2 * xm * s;
+                q = 1 - s;
+            }
+            else
+            {
+                q = fa / fc;
+                r = fb / fc;
+                p = s * (2 * xm * q * (q - r) - (b - a) * (r - 1));
+                q = (q - 1) * (r - 1) * (s - 1);
+            }
+            if (p > 0)
+                q = -q;
+            p = fabs(p);
+            if (2 * p < fmin(3 * xm * q - fabs(tol * q), fabs(e * q)))
+            {
+                e = d;
+                d = p / q;
+            }
+            else
+            {
+                d = xm;
+                e = d;
+            }
+        }
+        else
+        {
+            d = xm;
+            e = d;
+        }
+
+        a = b;
+        fa = fb;
+        b += fabs(d) > tol ? d : (xm > 0 ? tol : -tol);
+        fb = f(b);
+    }
+    return b;
+}
+
+/* Brent's method on alt(t) - x inside [a, b], whose ends bracket a crossing */
+static double RefineCrossing(Now *now, Obj *obj, double a, double fa, double b, double fb, double x, double *az)
+{
+    b = BrentRoot([&](double time) { return AltitudeAt(now, obj, time, NULL) - x; }, a, fa, b, fb);
+    if (az)
+        AltitudeAt(now, obj, b, az);
+    return b;
+}
+
+/* same contract as FindAltX, but instead of walking in fixed steps the
+ * search jumps by the time the object needs to reach x at its fastest
+ * possible rate, so no crossing can be skipped, and the bracketing
+ * interval is then refined with Brent's method. step is only the lower
+ * bound of a jump. transit tracking is left to FindAltitudeExtremum.
+ */
+static int FindAltXBracket(Now *now, Obj *obj, double step, double limit, int forward, int go_down, double *az, double *jd, double x)
+{
+    double orig = now->n_mjd;
+    double rate = MaxAltitudeRate(now, obj);
+    double dir = forward ? 1 : -1;
+
+    go_down = forward ? go_down : !go_down;
+
+    double prev_time = orig;
+    double prev = AltitudeAt(now, obj, orig, NULL) - x;
+
+    for (;;)
+    {
+        double gap = fabs(prev) / rate;
+        if (gap < step)
+            gap = step;
+
+        double current = prev_time + dir * gap;
+        if (dir * (current - orig) > limit)
+            current = orig + dir * limit;
+        if (current == prev_time)
+            break;
+
+        double curr = AltitudeAt(now, obj, current, NULL) - x;
+
+        if (go_down ? (prev >= 0 && curr <= 0) : (prev <= 0 && curr >= 0))
+        {
+            *jd = RefineCrossing(now, obj, prev_time, prev, current, curr, x, az);
+            now->n_mjd = orig;
+            return 0;
+        }
+
+        prev = curr;
+        prev_time = current;
+    }
+    now->n_mjd = orig;
+    return 1;
+}
+
+/* time of the highest (maximum) or lowest altitude of obj within
+ * [start, end] by Brent's minimization. alt and az are filled at that time.
+ */
+static double FindAltitudeExtremum(Now *now, Obj *obj, double start, double end, bool maximum, double *alt, double *az)
+{
+    const double golden = 0.3819660;
+    double sign = maximum ? -1 : 1;
+    double orig = now->n_mjd;
+    double a = start, b = end;
+    double x, w, v, fx, fw, fv, az_x;
+    double d = 0, e = 0;
+
+    x = w = v = a + golden * (b - a);
+    fx = fw = fv = sign * AltitudeAt(now, obj, x, &az_x);
+
+    for (int iter = 0; iter < 100; iter++)
+    {
+        double xm = 0.5 * (a + b);
+        double tol = TRANSIT_TOLERANCE, tol2 = 2 * tol;
+        if (fabs(x - xm) <= tol2 - 0.5 * (b - a))
+            break;
+
+        if (fabs(e) > tol)
+        {
+            double r = (x - w) * (fx - fv);
+            double q = (x - v) * (fx - fw);
+            double p = (x - v) * q - (x - w) * r;
+            q = 2 * (q - r);
+            if (q > 0)
+                p = -p;
+            q = fabs(q);
+            double etemp = e;
+            e = d;
+            if (fabs(p) >= fabs(0.5 * q * etemp) || p <= q * (a - x) || p >= q * (b - x))
+            {
+                e = x >= xm ? a - x : b - x;
+                d = golden * e;
+            }
+            else
+            {
+                d = p / q;
+                double u = x + d;
+                if (u - a < tol2 || b - u < tol2)
+                    d = xm > x ? tol : -tol;
+            }
+        }
+        else
+        {
+            e = x >= xm ? a - x : b - x;
+            d = golden * e;
+        }
+
+        double u = fabs(d) >= tol ? x + d : x + (d > 0 ? tol : -tol);
+        double az_u;
+        double fu = sign * AltitudeAt(now, obj, u, &az_u);
+
+        if (fu <= fx)
+        {
+            if (u >= x)
+                a = x;
+            else
+                b = x;
+            v = w; fv = fw;
+            w = x; fw = fx;
+            x = u; fx = fu; az_x = az_u;
+        }
+        else
+        {
+            if (u < x)
+                a = u;
+            else
+                b = u;
+            if (fu <= fw || w == x)
+            {
+                v = w; fv = fw;
+                w = u; fw = fu;
+            }
+            else if (fu <= fv || v == x || v == w)
+            {
+                v = u; fv = fu;
+            }
+        }
+    }
+
+    *alt = sign * fx;
+    *az = az_x;
+    now->n_mjd = orig;
+    return x;
+}
+
+int FindAltXSun(Now *now, double step, double limit, int forward, int go_down, double *jd, double x, int solver)
 {
+    STAT_TIMER(STAT_T_ALTX_SUN);
     double az, transit_az, transit_al, transit_tm;
     Obj *objs;
     getBuiltInObjs(&objs);
 
     Obj origObj = objs[SUN];
+    if (solver == RISET_SOLVER_BRACKET)
+        return FindAltXBracket(now, &origObj, step, limit, forward, go_down, &az, jd, x);
     return FindAltX(now, &origObj, step, limit, forward, go_down, &az, jd, &transit_az, &transit_al, &transit_tm, x);
 }
 
-int GetModifiedRiset(Now *now, int index, RiseSet *riset, double *el, double *az, bool up)
+int GetModifiedRiset(Now *now, int index, RiseSet *riset, double *el, double *az, bool up, int solver)
 {
     Obj *objs;
     getBuiltInObjs(&objs);
 
     Obj origObj = objs[index];
-    return GetModifiedRisetS(now, &origObj, 1.0 / 1440, 1.0, riset, el, az, up);
+    return GetModifiedRisetS(now, &origObj, 1.0 / 1440, 1.0, riset, el, az, up, solver);
+}
+
+static int GetModifiedRisetBracket(Now *now, Obj *obj, double step, double limit, RiseSet *riset, bool up, bool isUp)
+{
+    double *first_az = up ? &riset->rs_riseaz : &riset->rs_setaz;
+    double *first_tm = up ? &riset->rs_risetm : &riset->rs_settm;
+    double *second_az = up ? &riset->rs_setaz : &riset->rs_riseaz;
+    double *second_tm = up ? &riset->rs_settm : &riset->rs_risetm;
+
+    if (up == isUp)
+    {
+        if (FindAltXBracket(now, obj, step, limit, false, !up, first_az, first_tm, 0) != 0 ||
+            FindAltXBracket(now, obj, step, limit, true, up, second_az, second_tm, 0) != 0)
+            return RS_ERROR;
+    }
+    else
+    {
+        if (FindAltXBracket(now, obj, step, limit, true, !up, first_az, first_tm, 0) != 0)
+            return RS_ERROR;
+        // set time is always behind rise time
+        double orig = now->n_mjd;
+        now->n_mjd = *first_tm;
+        int result = FindAltXBracket(now, obj, step, limit, true, up, second_az, second_tm, 0);
+        now->n_mjd = orig;
+        if (result != 0)
+            return RS_ERROR;
+    }
+
+    if (up)
+    {
+        double transit_al, transit_az;
+        double transit_tm = FindAltitudeExtremum(now, obj, riset->rs_risetm, riset->rs_settm, true, &transit_al, &transit_az);
+        if (transit_al > riset->rs_tranalt)
+        {
+            riset->rs_tranalt = transit_al;
+            riset->rs_tranaz = transit_az;
+            riset->rs_trantm = transit_tm;
+        }
+    }
+    return 0;
+}
+
+#define SATELLITE_GM            3.986004418e14      /* m^3/s^2 */
+#define SATELLITE_REACH_MARGIN  (2.0 / 180.0 * M_PI)
+#define SATELLITE_MIN_STEP      (1.0 / SECONDS_PER_DAY)
+#define SATELLITE_MAX_STEP      (60.0 / SECONDS_PER_DAY)
+
+/* apogee radius of satillite in meters, from its mean motion */
+static double SatelliteApogee(const Obj *satillite)
+{
+    double n = satillite->es_n * 2 * M_PI / SECONDS_PER_DAY;
+    return cbrt(SATELLITE_GM / (n * n)) * (1 + satillite->es_e);
+}
+
+struct SatelliteSample
+{
+    double time;
+    double alt;
+    double az;
+    double rate;    // d alt / dt, rad/day
+    double skip;    // time it cannot rise within, days
+    bool eclipsed;
+};
+
+/* satillite is only above the horizon while the arc between the observer's
+ * zenith and it, seen from the earth's center, is under acos(site radius /
+ * its radius), which is widest at apogee. that arc closes at most as fast
+ * as the satellite sweeps around at perigee plus the earth turns.
+ */
+struct SatelliteGeometry
+{
+    double site;    // m
+    double horizon; // rad
+    double sweep;   // rad/day
+};
+
+static bool SatelliteGeometryFor(const Now *now, const Obj *satillite, SatelliteGeometry *geometry)
+{
+    double e = satillite->es_e;
+    double site = ERAD * (1 + now->n_elev);
+    double apogee = SatelliteApogee(satillite);
+    if (!(apogee > site))
+        return false;
+
+    geometry->site = site;
+    geometry->horizon = acos(site / apogee) + SATELLITE_REACH_MARGIN;
+    geometry->sweep = 1.1 * (satillite->es_n * 2 * M_PI * (1 + e) * (1 + e) / pow(1 - e * e, 1.5) + 2 * M_PI / SIDRATE);
+    return true;
+}
+
+static bool SampleSatellite(Now *now, Obj *satillite, const SatelliteGeometry &geometry, double time, SatelliteSample *sample)
+{
+    Obj current;
+    memcpy(&current, satillite, sizeof(Obj));
+
+    now->n_mjd = time;
+    if (obj_cir(now, &current) != 0 || isnan(current.s_range))
+        return false;
+
+    sample->time = time;
+    sample->alt = current.any.co_alt;
+    sample->az = current.any.co_az;
+    sample->rate = current.s_altv * SECONDS_PER_DAY;
+    sample->eclipsed = current.s_eclipsed != 0;
+
+    double range = current.s_range;
+    double arc = atan2(range * cos(sample->alt), geometry.site + range * sin(sample->alt));
+    sample->skip = arc > geometry.horizon ? (arc - geometry.horizon) / geometry.sweep : 0;
+    return true;
+}
+
+/* where the altitude is x between a and b, which bracket it, by Newton's
+ * method on the altitude rate, falling back to the secant and bisection
+ * whenever a step would leave the bracket */
+static void RefineSatelliteCrossing(Now *now, Obj *satillite, const SatelliteGeometry &geometry, SatelliteSample a, SatelliteSample b, SatelliteSample *crossing, double x = 0)
+{
+    *crossing = fabs(a.alt - x) < fabs(b.alt - x) ? a : b;
+    for (int iter = 0; iter < 50 && crossing->alt != x; iter++)
+    {
+        double lo = fmin(a.time, b.time), hi = fmax(a.time, b.time);
+        if (hi - lo < CROSSING_TOLERANCE || fabs(crossing->alt - x) < CROSSING_TOLERANCE * fabs(crossing->rate))
+            break;
+
+        double t = crossing->rate != 0 ? crossing->time - (crossing->alt - x) / crossing->rate : lo;
+        if (!(t > lo && t < hi))
+            t = a.time - (a.alt - x) * (b.time - a.time) / (b.alt - a.alt);
+        if (!(t > lo && t < hi))
+            t = 0.5 * (lo + hi);
+
+        SatelliteSample current;
+        if (!SampleSatellite(now, satillite, geometry, t, &current))
+            break;
+        *crossing = current;
+        if ((current.alt < x) == (a.alt < x))
+            a = current;
+        else
+            b = current;
+    }
+}
+
+/* first time after from that the altitude of satillite goes up through (or
+ * down through) the horizon, no later than end. each step goes to where the
+ * altitude would cross at its current rate, capped so a short pass is not
+ * stepped over, and below the horizon it also skips what the satellite
+ * cannot cover in time to rise. if peak is given, it is set to the pair of
+ * steps around the highest point where the altitude stops rising, as a
+ * long pass can have more than one. returns 0 on success, 1 if none is found.
+ */
+static int FindSatelliteCrossing(Now *now, Obj *satillite, const SatelliteGeometry &geometry, const SatelliteSample &from, double end, bool rising, SatelliteSample *crossing, SatelliteSample *peak = NULL)
+{
+    double sign = rising ? 1 : -1;
+    SatelliteSample prev = from;
+    bool armed = sign * prev.alt < 0;
+
+    while (prev.time < end)
+    {
+        // until armed, the altitude has to get to the other side first
+        double away = armed ? sign * prev.alt : -sign * prev.alt;
+        double rate = armed ? sign * prev.rate : -sign * prev.rate;
+
+        double step = rate > 0 ? -away / rate + SATELLITE_MIN_STEP : SATELLITE_MAX_STEP;
+        step = fmin(fmax(step, SATELLITE_MIN_STEP), SATELLITE_MAX_STEP);
+        if (prev.alt < 0)
+            step = fmax(step, prev.skip);
+
+        SatelliteSample next;
+        if (!SampleSatellite(now, satillite, geometry, fmin(prev.time + step, end), &next))
+            return 1;
+
+        if (peak && prev.rate > 0 && next.rate <= 0 && fmax(prev.alt, next.alt) > fmax(peak[0].alt, peak[1].alt))
+        {
+            peak[0] = prev;
+            peak[1] = next;
+        }
+
+        if (armed && sign * next.alt >= 0)
+        {
+            RefineSatelliteCrossing(now, satillite, geometry, prev, next, crossing);
+            return 0;
+        }
+        if (sign * next.alt < 0)
+            armed = true;
+        prev = next;
+    }
+    return 1;
+}
+
+/* culmination between a and b, where the altitude rate changes sign, by
+ * the Illinois variant of regula falsi on the rate */
+static void FindSatelliteCulmination(Now *now, Obj *satillite, const SatelliteGeometry &geometry, SatelliteSample a, SatelliteSample b, SatelliteSample *culmination)
+{
+    *culmination = a.alt > b.alt ? a : b;
+    if (!(a.rate > 0 && b.rate < 0))
+        return;
+
+    int side = 0;
+    for (int iter = 0; iter < 50 && b.time - a.time > CROSSING_TOLERANCE; iter++)
+    {
+        double t = a.time + a.rate * (b.time - a.time) / (a.rate - b.rate);
+        if (!(t > a.time && t < b.time))
+            t = 0.5 * (a.time + b.time);
+
+        SatelliteSample current;
+        if (!SampleSatellite(now, satillite, geometry, t, &current))
+            break;
+        *culmination = current;
+        if (current.rate == 0)
+            break;
+        if (current.rate > 0)
+        {
+            a = current;
+            if (side == 1)
+                b.rate *= 0.5;
+            side = 1;
+        }
+        else
+        {
+            b = current;
+            if (side == -1)
+                a.rate *= 0.5;
+            side = -1;
+        }
+    }
+}
+
+/* GetModifiedRisetS for earth satellites. obj_earthsat gives the altitude
+ * rate along with the position, so crossings are predicted from it and
+ * refined by Newton's method to CROSSING_TOLERANCE, and the arcs where the
+ * satellite is out of reach are skipped without propagating through them.
+ */
+static int GetSatelliteRiset(Now *now, Obj *satillite, double limit, RiseSet *riset, bool up)
+{
+    double orig = now->n_mjd;
+    double *first_az = up ? &riset->rs_riseaz : &riset->rs_setaz;
+    double *first_tm = up ? &riset->rs_risetm : &riset->rs_settm;
+    double *second_az = up ? &riset->rs_setaz : &riset->rs_riseaz;
+    double *second_tm = up ? &riset->rs_settm : &riset->rs_risetm;
+
+    SatelliteGeometry geometry;
+    SatelliteSample start, first, second, peak[2];
+    if (!SatelliteGeometryFor(now, satillite, &geometry) ||
+        !SampleSatellite(now, satillite, geometry, orig, &start) ||
+        FindSatelliteCrossing(now, satillite, geometry, start, orig + limit, up, &first) != 0)
+    {
+        now->n_mjd = orig;
+        return RS_ERROR;
+    }
+
+    peak[0] = peak[1] = first;
+    if (FindSatelliteCrossing(now, satillite, geometry, first, first.time + limit, !up, &second, up ? peak : NULL) != 0)
+    {
+        now->n_mjd = orig;
+        return RS_ERROR;
+    }
+
+    *first_az = first.az;
+    *first_tm = first.time;
+    *second_az = second.az;
+    *second_tm = second.time;
+
+    if (up)
+    {
+        SatelliteSample culmination;
+        FindSatelliteCulmination(now, satillite, geometry, peak[0], peak[1], &culmination);
+        riset->rs_tranalt = culmination.alt;
+        riset->rs_tranaz = culmination.az;
+        riset->rs_trantm = culmination.time;
+    }
+    now->n_mjd = orig;
+    return 0;
 }
 
-int GetModifiedRisetS(Now *now, Obj *obj, double step, double limit, RiseSet *riset, double *el, double *az, bool up)
+int GetModifiedRisetS(Now *now, Obj *obj, double step, double limit, RiseSet *riset, double *el, double *az, bool up, int solver)
 {
+    STAT_TIMER(STAT_T_MODIFIED_RISET);
     Now backup;
     memcpy(&backup, now, sizeof(Now));
 
@@ -182,6 +724,13 @@ int GetModifiedRisetS(Now *now, Obj *obj, double step, double limit, RiseSet *ri
     riset->rs_tranalt = 0;
     riset->rs_trantm = 0;
 
+    if (solver == RISET_SOLVER_BRACKET)
+    {
+        if (newObj.o_type == EARTHSAT)
+            return GetSatelliteRiset(&backup, &newObj, limit, riset, up);
+        return GetModifiedRisetBracket(&backup, &newObj, step, limit, riset, up, isUp);
+    }
+
     if (((up && isUp) || (!up && !isUp)) && newObj.o_type != EARTHSAT)
     {
         if (FindAlt0(&backup, &newObj, step, limit, false, !up, up ? &riset->rs_riseaz : &riset->rs_setaz, up ? &riset->rs_risetm : &riset->rs_settm, &riset->rs_tranaz, &riset->rs_tranalt, &riset->rs_trantm) == 0 &&
@@ -239,8 +788,10 @@ double calc_phase(double x, double antitarget)
     memset(&now, 0, sizeof(Now));
     now.n_mjd = x;
     now.n_pressure = 1010;
-    obj_cir(&now, &sunObj);
-    obj_cir(&now, &moonObj);
+    TimeCtx tc;
+    time_ctx(&now, &tc);
+    obj_cir_ctx(&now, &tc, &sunObj);
+    obj_cir_ctx(&now, &tc, &moonObj);
     double slon, slat, mlon, mlat;
     eq_ecl(now.n_mjd, sunObj.pl.co_gaera, sunObj.pl.co_gaedec, &slat, &slon);
     eq_ecl(now.n_mjd, moonObj.pl.co_gaera, moonObj.pl.co_gaedec, &mlat, &mlon);
@@ -255,16 +806,12 @@ double CurrentMoonPhase(double seconds_since_epoch)
     return k;
 }
 
-double FindMoonPhase(double seconds_since_epoch, double motion, double target)
+/* secant iteration for the time near ephem day x at which calc_phase() is 0 */
+static double RefineMoonPhase(double x, double antitarget)
 {
-    double antitarget = target + M_PI;
-    double time = EpochToEphemTime(seconds_since_epoch);
-    double res = calc_phase(time, antitarget);
-    double angle_to_cover = fmod2(-res, motion);
-    double dd = time + 29.53 * angle_to_cover / (2 * M_PI);
     double hour = 1.0 / 24;
-    double x0 = dd;
-    double x1 = dd + hour;
+    double x0 = x;
+    double x1 = x + hour;
     double f0 = calc_phase(x0, antitarget);
     double f1 = calc_phase(x1, antitarget);
     while (fabs(x1 - x0) > 1.0 / 24 / 60 && f1 != f0)
@@ -275,7 +822,146 @@ double FindMoonPhase(double seconds_since_epoch, double motion, double target)
         f0 = f1;
         f1 = calc_phase(x1, antitarget);
     }
-    return EphemToEpochTime(x1);
+    return x1;
+}
+
+double FindMoonPhase(double seconds_since_epoch, double motion, double target)
+{
+    STAT_TIMER(STAT_T_MOON_PHASE);
+    double antitarget = target + M_PI;
+    double time = EpochToEphemTime(seconds_since_epoch);
+    double res = calc_phase(time, antitarget);
+    double angle_to_cover = fmod2(-res, motion);
+    double dd = time + 29.53 * angle_to_cover / (2 * M_PI);
+    return EphemToEpochTime(RefineMoonPhase(dd, antitarget));
+}
+
+/* the principal phases, in order, over a span grown on demand. times are
+ * ephem days; the phase of each is the one after that of the one before */
+static struct {
+    mutex lock;
+    vector<double> times;
+    int firstPhase;
+} moonPhaseTable;
+
+/* phase events either side of [start, end] that queries may need */
+#define MOON_PHASE_MARGIN       31.0
+/* further than this, in days, from the table and it is started afresh */
+#define MOON_PHASE_MAX_GAP      (3 * 365.25)
+
+static double MoonPhaseTarget(int phase)
+{
+    return phase * M_PI / 2 + M_PI;
+}
+
+/* grow moonPhaseTable to hold every event in [start, end] ephem days, plus
+ * margins. false, with the table as it was or holding only good events, if
+ * the range or an event found is not finite. call with moonPhaseTable.lock
+ * held */
+static bool CoverMoonPhases(double start, double end)
+{
+    if (!isfinite(start) || !isfinite(end))
+        return false;
+
+    /* shared, so as good as they come whatever the caller's tier */
+    AccuracyScope full(ACC_FULL);
+    vector<double> &times = moonPhaseTable.times;
+    start -= MOON_PHASE_MARGIN;
+    end += MOON_PHASE_MARGIN;
+
+    if (times.empty() || end < times.front() - MOON_PHASE_MAX_GAP || start > times.back() + MOON_PHASE_MAX_GAP)
+    {
+        /* seed with the last event before start */
+        double angle = fmod2(-calc_phase(start, M_PI), 2 * M_PI);
+        int phase = (int)floor((2 * M_PI - angle) / (M_PI / 2)) % 4;
+        double past = 2 * M_PI - angle - phase * M_PI / 2;
+        double seed = RefineMoonPhase(start - 29.53 * past / (2 * M_PI), MoonPhaseTarget(phase));
+        if (!isfinite(seed))
+            return false;
+        times.assign(1, seed);
+        moonPhaseTable.firstPhase = phase;
+    }
+
+    /* each event from its neighbour, a quarter of a mean lunation away */
+    if (times.front() > start)
+    {
+        vector<double> earlier;
+        int phase = moonPhaseTable.firstPhase;
+        double time = times.front();
+        while (time > start)
+        {
+            int before = (phase + 3) % 4;
+            time = RefineMoonPhase(time - 29.53 / 4, MoonPhaseTarget(before));
+            if (!isfinite(time))
+                break;
+            phase = before;
+            earlier.push_back(time);
+        }
+        times.insert(times.begin(), earlier.rbegin(), earlier.rend());
+        moonPhaseTable.firstPhase = phase;
+        if (!isfinite(time))
+            return false;
+    }
+    int phase = (moonPhaseTable.firstPhase + (int)(times.size() - 1)) % 4;
+    while (times.back() < end)
+    {
+        phase = (phase + 1) % 4;
+        double time = RefineMoonPhase(times.back() + 29.53 / 4, MoonPhaseTarget(phase));
+        if (!isfinite(time))
+            return false;
+        times.push_back(time);
+    }
+    return true;
+}
+
+vector<MoonPhaseEvent> GetMoonPhaseEvents(double startTime, double endTime)
+{
+    STAT_TIMER(STAT_T_MOON_PHASE_EVENTS);
+    double start = EpochToEphemTime(startTime);
+    double end = EpochToEphemTime(endTime);
+
+    vector<MoonPhaseEvent> events;
+    lock_guard<mutex> guard(moonPhaseTable.lock);
+    if (!CoverMoonPhases(start, end))
+        return events;
+    const vector<double> &times = moonPhaseTable.times;
+
+    size_t i = lower_bound(times.begin(), times.end(), start) - times.begin();
+    for (; i < times.size() && times[i] < end; i++)
+    {
+        MoonPhaseEvent event;
+        event.time = EphemToEpochTime(times[i]);
+        event.phase = (moonPhaseTable.firstPhase + (int)i) % 4;
+        events.push_back(event);
+    }
+    return events;
+}
+
+double FindMoonPhaseEvent(double seconds_since_epoch, int phase, bool forward)
+{
+    STAT_TIMER(STAT_T_MOON_PHASE_EVENTS);
+    if (phase < -1 || phase > MOON_PHASE_LAST_QUARTER || !isfinite(seconds_since_epoch))
+        return NAN;
+    double time = EpochToEphemTime(seconds_since_epoch);
+
+    lock_guard<mutex> guard(moonPhaseTable.lock);
+    if (!CoverMoonPhases(time, time))
+        return NAN;
+    const vector<double> &times = moonPhaseTable.times;
+
+    /* first after time going forward, last at or before it going back, then
+     * on in the same direction to the phase wanted, at most three more. the
+     * margins of CoverMoonPhases hold a whole lunation either side */
+    ptrdiff_t i = upper_bound(times.begin(), times.end(), time) - times.begin();
+    ptrdiff_t count = (ptrdiff_t)times.size();
+    int step = forward ? 1 : -1;
+    if (!forward)
+        i--;
+    while (i >= 0 && i < count && phase >= 0 && (moonPhaseTable.firstPhase + i) % 4 != phase)
+        i += step;
+    if (i < 0 || i >= count)
+        return NAN;
+    return EphemToEpochTime(times[i]);
 }
 
 double GetLST(double now, double longitude)
@@ -292,6 +978,7 @@ double GetLST(double now, double longitude)
 
 void GetRADECRiset(double ra, double dec, double longitude, double latitude, double now, double *riseTime, double *setTime, double *transitTime, int *status, double *az_r, double *az_s, double *az_c, double *az_t, double *el_c, double *el_t)
 {
+    STAT_TIMER(STAT_T_RADEC_RISET);
     double r, s;
     riset(radian(ra), radian(dec), radian(latitude), 0, &r, &s, az_r, az_s, status);
     double lst = GetLST(now, longitude);
@@ -323,34 +1010,340 @@ void GetRADECRiset(double ra, double dec, double longitude, double latitude, dou
     }
 }
 
-int GetSatellitePosition(const char* line0, const char* line1, const char* line2, double longitude, double latitude, double altitude, double seconds_since_epoch, double* el, double* az)
-{
-    Obj satillite;
-    /* Construct the Satellite */
-    if (db_tle((char*)line0, (char*)line1, (char*)line2, &satillite) != 0)
-        return 0;
+#define STAR_PM_RADIANS   (M_PI / 180 / 3600 / 1000) /* per milliarcsecond */
+#define STAR_SUN_GM       1.32712438e20              /* m^3/s^2, as deflect() */
+#define STAR_LIGHT_SPEED  299792458.0                /* m/s */
+#define STAR_DEFLECT_MIN  (-0.99999048)              /* cos 179.75 deg, inside the disc */
+#define STAR_DEFLECT_MAX  (-0.98480775)              /* cos 170 deg */
 
-    /* Construct the observer */
-    Now now;
-    ConfigureObserver(longitude, latitude, altitude, seconds_since_epoch, &now);
+/* apparent equatorial vector of date of star i, not quite of unit length:
+ * proper motion, deflection, rotation and aberration of transform */
+static inline void StarApparentVector(const StarTransform *transform, const StarCatalog *stars, int i, double *ex, double *ey, double *ez)
+{
+    const double (*m)[3] = transform->rotation;
+    const double *a = transform->aberration;
+    const double *e = transform->earth;
+
+    double ra = radian(stars->ra[i]);
+    double dec = radian(stars->dec[i]);
+    if (stars->pmRA)
+        ra += stars->pmRA[i] * STAR_PM_RADIANS * transform->years;
+    if (stars->pmDec)
+        dec += stars->pmDec[i] * STAR_PM_RADIANS * transform->years;
+    double x = cos(dec) * cos(ra);
+    double y = cos(dec) * sin(ra);
+    double z = sin(dec);
+
+    /* deflect() only bothers within 10 degrees of the sun */
+    double qe = e[0] * x + e[1] * y + e[2] * z;
+    double g = qe >= STAR_DEFLECT_MIN && qe <= STAR_DEFLECT_MAX ? transform->deflection / (1 + qe) : 0;
+    x += g * (e[0] - qe * x);
+    y += g * (e[1] - qe * y);
+    z += g * (e[2] - qe * z);
+
+    *ex = m[0][0] * x + m[0][1] * y + m[0][2] * z + a[0];
+    *ey = m[1][0] * x + m[1][1] * y + m[1][2] * z + a[1];
+    *ez = m[2][0] * x + m[2][1] * y + m[2][2] * z + a[2];
+}
 
-    /* Current Position */
-    obj_earthsat(&now, &satillite);
+void GetStarRisets(const StarCatalog *stars, double longitude, double latitude, double now, StarRisets *risets)
+{
+    STAT_TIMER(STAT_T_STAR_RISETS);
+    /* all that depends only on the observer and the night, once */
+    StarTransform transform;
+    GetStarTransform(longitude, latitude, 0, now, &transform);
+    double lst = radian(GetLST(now, longitude) * 15);
+    double phi = radian(latitude);
+    double sinPhi = sin(phi);
+    double cosPhi = cos(phi);
+    double secondsPerRadian = SECONDS_PER_DAY * SIDRATE / (2 * M_PI);
+
+    /* then each star moved by its proper motion and taken from J2000 to its
+     * apparent place of date, as TransformStars, so that it meets the
+     * apparent sidereal time, and the closed form hour angle equations of
+     * riset() and hadec_aa(), kept free of branches other than selects so
+     * the loop vectorises over the arrays */
+    for (int i = 0; i < stars->count; i++)
+    {
+        double ex, ey, ez;
+        StarApparentVector(&transform, stars, i, &ex, &ey, &ez);
+        double ra = atan2(ey, ex);
+        double dec = asin(ez / sqrt(ex * ex + ey * ey + ez * ez));
+        double sinDec = sin(dec);
+        double cosDec = cos(dec);
+
+        double ha = lst - ra;
+        double currentAlt = asin(sinPhi * sinDec + cosPhi * cosDec * cos(ha));
+        double currentAz = atan2(-cosDec * sin(ha), sinDec * cosPhi - cosDec * cos(ha) * sinPhi);
+        currentAz = currentAz < 0 ? currentAz + 2 * M_PI : currentAz;
+
+        /* circumpolar cases from the zenith distance extremes, as riset() */
+        double zmin = fabs(dec - phi);
+        double zmax = M_PI - fabs(dec + phi);
+        int status = zmax <= M_PI / 2 + 1e-9 ? -1 : zmin >= M_PI / 2 - 1e-9 ? 1 : 0;
+
+        double cosH = -sinPhi * sinDec / (cosPhi * cosDec);
+        double h = acos(fmax(-1.0, fmin(1.0, cosH)));
+        double setAz = atan2(-cosDec * sin(h), sinDec * cosPhi - cosDec * cos(h) * sinPhi);
+        setAz = setAz < 0 ? setAz + 2 * M_PI : setAz;
+        double riseAz = setAz > 0 ? 2 * M_PI - setAz : 0;
+
+        /* sidereal angles from now to the next setting, and back from it to
+         * the rise and transit before */
+        double toSet = fmod(ra + h - lst, 2 * M_PI);
+        toSet = toSet < 0 ? toSet + 2 * M_PI : toSet;
+        double toTransit = fmod(ra - lst, 2 * M_PI);
+        toTransit = toTransit < 0 ? toTransit + 2 * M_PI : toTransit;
+        toTransit = status == 0 ? toSet - h : toTransit;
+
+        bool rises = status == 0;
+        bool transits = status != 1;
+        if (risets->riseTime)
+            risets->riseTime[i] = rises ? now + (toSet - 2 * h) * secondsPerRadian : 0;
+        if (risets->setTime)
+            risets->setTime[i] = rises ? now + toSet * secondsPerRadian : 0;
+        if (risets->transitTime)
+            risets->transitTime[i] = transits ? now + toTransit * secondsPerRadian : 0;
+        if (risets->riseAz)
+            risets->riseAz[i] = rises ? riseAz : 0;
+        if (risets->setAz)
+            risets->setAz[i] = rises ? setAz : 0;
+        if (risets->transitAz)
+            risets->transitAz[i] = dec > phi ? 0 : M_PI;
+        if (risets->transitAlt)
+            risets->transitAlt[i] = M_PI / 2 - fabs(phi - dec);
+        if (risets->currentAz)
+            risets->currentAz[i] = currentAz;
+        if (risets->currentAlt)
+            risets->currentAlt[i] = currentAlt;
+        if (risets->status)
+            risets->status[i] = status;
+    }
+}
 
-    if (el)
-        *el = satillite.any.co_alt;
-    if (az)
-        *az = satillite.any.co_az;
-    return 1;
+void GetStarTransform(double longitude, double latitude, double altitude, double now, StarTransform *transform)
+{
+    Now _now;
+    ConfigureObserver(longitude, latitude, altitude, now, &_now);
+    TimeCtx tc;
+    time_ctx(&_now, &tc);
+
+    /* earth from the sun, taken back to J2000 to meet the catalog vectors */
+    double ra, dec, x, y, z;
+    ecl_eq(tc.tc_mjed, 0.0, tc.tc_lsn - M_PI, &ra, &dec);
+    sphcart(ra, dec, 1.0, &x, &y, &z);
+    for (int i = 0; i < 3; i++)
+        transform->earth[i] = tc.tc_prec[0][i] * x + tc.tc_prec[1][i] * y + tc.tc_prec[2][i] * z;
+    transform->deflection = 2 * STAR_SUN_GM / (STAR_LIGHT_SPEED * STAR_LIGHT_SPEED * MAU) / tc.tc_rsn;
+
+    /* precession then nutation, as obj_fixed() does one star at a time */
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            transform->rotation[i][j] = tc.tc_nut[i][0] * tc.tc_prec[0][j] + tc.tc_nut[i][1] * tc.tc_prec[1][j] + tc.tc_nut[i][2] * tc.tc_prec[2][j];
+
+    /* the velocity ab_eq() adds */
+    double L = 2 * M_PI * (0.27908 + 100.00214 * (tc.tc_mjed - J2000) / 36525.0);
+    transform->aberration[0] = -0.994e-4 * sin(L);
+    transform->aberration[1] = 0.912e-4 * cos(L);
+    transform->aberration[2] = 0.395e-4 * cos(L);
+
+    /* about the pole by local sidereal time, then over to the horizon, so
+     * that alt and az come out as from hadec_aa() */
+    double lst;
+    tc_lst(&tc, &_now, &lst);
+    double sinLst = sin(hrrad(lst)), cosLst = cos(hrrad(lst));
+    double sinPhi = sin(_now.n_lat), cosPhi = cos(_now.n_lat);
+    transform->horizon[0][0] = -sinPhi * cosLst;
+    transform->horizon[0][1] = -sinPhi * sinLst;
+    transform->horizon[0][2] = cosPhi;
+    transform->horizon[1][0] = -sinLst;
+    transform->horizon[1][1] = cosLst;
+    transform->horizon[1][2] = 0;
+    transform->horizon[2][0] = cosPhi * cosLst;
+    transform->horizon[2][1] = cosPhi * sinLst;
+    transform->horizon[2][2] = sinPhi;
+
+    transform->years = (_now.n_mjd - J2000) / 365.25;
+    transform->airPressure = _now.n_pressure;
+    transform->airTemp = _now.n_temp;
 }
 
-int GetSatelliteStatus(const char* line0, const char* line1, const char* line2, double seconds_since_epoch, double* sublng, double* sublat, double* elevation)
+void TransformStars(const StarTransform *transform, const StarCatalog *stars, SkyPositions *positions)
 {
-    Obj satillite;
-    /* Construct the Satellite */
+    STAT_TIMER(STAT_T_TRANSFORM_STARS);
+    const double (*h)[3] = transform->horizon;
+
+    /* unit vectors through the one deflection, rotation and offset, star by
+     * star with no branches but selects and ones the compiler can hoist, so
+     * the loop vectorises */
+    for (int i = 0; i < stars->count; i++)
+    {
+        double ex, ey, ez;
+        StarApparentVector(transform, stars, i, &ex, &ey, &ez);
+        double r = sqrt(ex * ex + ey * ey + ez * ez);
+
+        if (positions->ra)
+        {
+            double apparentRA = atan2(ey, ex);
+            positions->ra[i] = apparentRA < 0 ? apparentRA + 2 * M_PI : apparentRA;
+        }
+        if (positions->dec)
+            positions->dec[i] = asin(ez / r);
+        if (positions->az)
+        {
+            double north = h[0][0] * ex + h[0][1] * ey + h[0][2] * ez;
+            double east = h[1][0] * ex + h[1][1] * ey + h[1][2] * ez;
+            double az = atan2(east, north);
+            positions->az[i] = az < 0 ? az + 2 * M_PI : az;
+        }
+        if (positions->alt)
+            positions->alt[i] = asin((h[2][0] * ex + h[2][1] * ey + h[2][2] * ez) / r);
+    }
+
+    /* refraction is iterative, so a separate pass */
+    if (positions->alt)
+    {
+        for (int i = 0; i < stars->count; i++)
+            refract(transform->airPressure, transform->airTemp, positions->alt[i], &positions->alt[i]);
+    }
+}
+
+int WarmEphemerisCache(double startTime, double endTime, double tolerance)
+{
+    STAT_TIMER(STAT_T_WARM_CACHE);
+    /* a day of margin for deltaT and light time */
+    double start = EpochToEphemTime(startTime) - 1;
+    double end = EpochToEphemTime(endTime) + 1;
+
+    for (int p = MERCURY; p <= MOON; p++)
+    {
+        if (ephc_warm((PLCode)p, start, end, tolerance) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int WriteEphemerisFile(const char *path, double startTime, double endTime, double tolerance)
+{
+    double start = EpochToEphemTime(startTime) - 1;
+    double end = EpochToEphemTime(endTime) + 1;
+    return ephc_save((char *)path, start, end, tolerance);
+}
+
+int LoadEphemerisFile(const char *path)
+{
+    return ephc_load((char *)path);
+}
+
+int LoadDeltaTFile(const char *path)
+{
+    return deltat_load((char *)path);
+}
+
+void GetSkyPositions(const int *indices, int objectCount, const double *times, int timeCount, double longitude, double latitude, double altitude, SkyPositions *positions)
+{
+    STAT_TIMER(STAT_T_SKY_POSITIONS);
+    Obj *objs;
+    getBuiltInObjs(&objs);
+
+    vector<Obj> bodies;
+    bodies.reserve(objectCount);
+    for (int i = 0; i < objectCount; i++)
+        bodies.push_back(objs[indices[i]]);
+
+    Now now;
+    ConfigureObserver(longitude, latitude, altitude, 0, &now);
+
+    /* instants outside, bodies inside: the sun position, nutation, obliquity,
+     * sidereal time and deltaT are found once per instant for all bodies */
+    TimeCtx tc;
+    for (int t = 0; t < timeCount; t++)
+    {
+        now.n_mjd = EpochToEphemTime(times[t]);
+        time_ctx(&now, &tc);
+        for (int i = 0; i < objectCount; i++)
+        {
+            Obj *obj = &bodies[i];
+            obj_cir_ctx(&now, &tc, obj);
+
+            size_t k = (size_t)i * timeCount + t;
+            if (positions->alt)
+                positions->alt[k] = obj->s_alt;
+            if (positions->az)
+                positions->az[k] = obj->s_az;
+            if (positions->ra)
+                positions->ra[k] = obj->s_ra;
+            if (positions->dec)
+                positions->dec[k] = obj->s_dec;
+            if (positions->distance)
+                positions->distance[k] = obj->s_edist;
+            if (positions->magnitude)
+                positions->magnitude[k] = get_mag(obj);
+        }
+    }
+}
+
+struct SatelliteHandle
+{
+    Obj obj;
+};
+
+SatelliteHandle *CreateSatelliteHandle(const char* line0, const char* line1, const char* line2)
+{
+    auto satellite = new SatelliteHandle;
+    if (db_tle((char*)line0, (char*)line1, (char*)line2, &satellite->obj) != 0 || esat_init(&satellite->obj) != 0)
+    {
+        delete satellite;
+        return nullptr;
+    }
+    return satellite;
+}
+
+void DestroySatelliteHandle(SatelliteHandle *satellite)
+{
+    if (!satellite)
+        return;
+    esat_free(&satellite->obj);
+    delete satellite;
+}
+
+/* satillite is taken by value, the caller's copy is never touched */
+static int SatellitePosition(Obj satillite, double longitude, double latitude, double altitude, double seconds_since_epoch, double* el, double* az)
+{
+    /* Construct the observer */
+    Now now;
+    ConfigureObserver(longitude, latitude, altitude, seconds_since_epoch, &now);
+
+    /* Current Position */
+    obj_earthsat(&now, &satillite);
+
+    if (el)
+        *el = satillite.any.co_alt;
+    if (az)
+        *az = satillite.any.co_az;
+    return 1;
+}
+
+int GetSatellitePosition(const char* line0, const char* line1, const char* line2, double longitude, double latitude, double altitude, double seconds_since_epoch, double* el, double* az)
+{
+    STAT_TIMER(STAT_T_SATELLITE_POSITION);
+    Obj satillite;
+    /* Construct the Satellite */
     if (db_tle((char*)line0, (char*)line1, (char*)line2, &satillite) != 0)
         return 0;
+    return SatellitePosition(satillite, longitude, latitude, altitude, seconds_since_epoch, el, az);
+}
 
+int GetSatellitePosition(const SatelliteHandle *satellite, double longitude, double latitude, double altitude, double seconds_since_epoch, double* el, double* az)
+{
+    STAT_TIMER(STAT_T_SATELLITE_POSITION);
+    if (!satellite)
+        return 0;
+    return SatellitePosition(satellite->obj, longitude, latitude, altitude, seconds_since_epoch, el, az);
+}
+
+static int SatelliteStatus(Obj satillite, double seconds_since_epoch, double* sublng, double* sublat, double* elevation)
+{
     /* Construct the observer */
     Now now;
     ConfigureObserver(0, 0, 0, seconds_since_epoch, &now);
@@ -367,69 +1360,383 @@ int GetSatelliteStatus(const char* line0, const char* line1, const char* line2,
     return 1;
 }
 
-int GetNextSatellitePass(const char* line0, const char* line1, const char* line2, double seconds_since_epoch, double longitude, double latitude, double altitude, RiseSet* riset, RiseSet* visibleRiset, double* visibleRiseAlt, double* visibleSetAlt)
+int GetSatelliteStatus(const char* line0, const char* line1, const char* line2, double seconds_since_epoch, double* sublng, double* sublat, double* elevation)
 {
-    double azimuth, elevation;
+    STAT_TIMER(STAT_T_SATELLITE_STATUS);
     Obj satillite;
     /* Construct the Satellite */
     if (db_tle((char*)line0, (char*)line1, (char*)line2, &satillite) != 0)
         return 0;
+    return SatelliteStatus(satillite, seconds_since_epoch, sublng, sublat, elevation);
+}
 
-    /* Construct the observer */
-    Now now;
-    ConfigureObserver(longitude, latitude, altitude, seconds_since_epoch, &now);
-    int result = GetModifiedRisetS(&now, &satillite, 1.0 / 1440 / 6, 10, riset, &elevation, &azimuth, true);
-    if (result == 0 && visibleRiset) {
-        double step = 1.0 / 1440 / 6;
-        double time = riset->rs_risetm;
-        bool visibleFound = false;
-        for (; time < riset->rs_settm; time += step)
-        {
-            Now current;
-            ConfigureObserver(longitude, latitude, altitude, EphemToEpochTime(time), &current);
-            Obj sunObj;
-            sunObj.pl.plo_code = SUN;
-            sunObj.any.co_type = PLANET;
-            obj_cir(&current, &sunObj);
-            double sunAltitude = sunObj.pl.co_alt / M_PI * 180;
-            bool visible = sunAltitude < -6 && sunAltitude > -30;
-            if (visible)
+int GetSatelliteStatus(const SatelliteHandle *satellite, double seconds_since_epoch, double* sublng, double* sublat, double* elevation)
+{
+    STAT_TIMER(STAT_T_SATELLITE_STATUS);
+    if (!satellite)
+        return 0;
+    return SatelliteStatus(satellite->obj, seconds_since_epoch, sublng, sublat, elevation);
+}
+
+#define VISIBLE_SATELLITE_ALT   (10.0 / 180.0 * M_PI)
+#define VISIBLE_SUN_ALT_MAX     (-6.0 / 180.0 * M_PI)
+#define VISIBLE_SUN_ALT_MIN     (-30.0 / 180.0 * M_PI)
+#define VISIBLE_SUN_STEP        (300.0 / SECONDS_PER_DAY)
+#define VISIBLE_SATELLITE_STEP  (30.0 / SECONDS_PER_DAY)
+
+/* the sun's altitude over a pass, from its apparent ra/dec at both ends
+ * interpolated in between and the observer's sidereal time, so the sun
+ * theory is only evaluated twice however often this is asked */
+struct SunTrack
+{
+    double start, end;
+    double ra, dec;         // at start, rad
+    double dra, ddec;       // change to end, rad
+    double lst;             // at start, rad
+    double sinLat, cosLat;
+    double airPressure, airTemp;
+};
+
+static void SunTrackFor(const Now *now, double start, double end, SunTrack *track)
+{
+    Now current;
+    memcpy(&current, now, sizeof(Now));
+
+    Obj sunObj;
+    memset(&sunObj, 0, sizeof(Obj));
+    sunObj.pl.plo_code = SUN;
+    sunObj.any.co_type = PLANET;
+
+    current.n_mjd = end;
+    obj_cir(&current, &sunObj);
+    double ra1 = sunObj.s_gaera, dec1 = sunObj.s_gaedec;
+
+    current.n_mjd = start;
+    obj_cir(&current, &sunObj);
+    now_lst(&current, &track->lst);
+
+    track->start = start;
+    track->end = end;
+    track->ra = sunObj.s_gaera;
+    track->dec = sunObj.s_gaedec;
+    track->dra = remainder(ra1 - track->ra, 2 * M_PI);
+    track->ddec = dec1 - track->dec;
+    track->lst = hrrad(track->lst);
+    track->sinLat = sin(now->n_lat);
+    track->cosLat = cos(now->n_lat);
+    track->airPressure = now->n_pressure;
+    track->airTemp = now->n_temp;
+}
+
+static double SunTrackAltitude(const SunTrack &track, double time)
+{
+    double f = track.end > track.start ? (time - track.start) / (track.end - track.start) : 0;
+    double ra = track.ra + f * track.dra;
+    double dec = track.dec + f * track.ddec;
+    double ha = track.lst + (time - track.start) * 2 * M_PI / SIDRATE - ra;
+    double alt = asin(track.sinLat * sin(dec) + track.cosLat * cos(dec) * cos(ha));
+    double apparent;
+    refract(track.airPressure, track.airTemp, alt, &apparent);
+    return apparent;
+}
+
+static bool SunAllowsVisibility(double sunAlt)
+{
+    return sunAlt < VISIBLE_SUN_ALT_MAX && sunAlt > VISIBLE_SUN_ALT_MIN;
+}
+
+/* the sun interval of [start, end] that comes first where the sun is low
+ * enough for the sky to be dark but high enough to light the satellite.
+ * the track is cheap, so its boundaries are bisected */
+static bool FindSunVisibility(const SunTrack &track, double start, double end, double *from, double *to)
+{
+    double prev_time = start;
+    bool prev = SunAllowsVisibility(SunTrackAltitude(track, start));
+    bool found = prev;
+    *from = start;
+
+    while (prev_time < end)
+    {
+        double time = fmin(prev_time + VISIBLE_SUN_STEP, end);
+        bool curr = SunAllowsVisibility(SunTrackAltitude(track, time));
+        if (curr != prev)
+        {
+            double a = prev_time, b = time;
+            while (b - a > CROSSING_TOLERANCE)
             {
-                obj_cir(&current, &satillite);
-                visible = (satillite.es.co_alt / M_PI * 180) >= 10.0 && !satillite.s_eclipsed;
+                double m = 0.5 * (a + b);
+                if (SunAllowsVisibility(SunTrackAltitude(track, m)) == prev)
+                    a = m;
+                else
+                    b = m;
             }
-            if (!visibleFound)
+            if (found)
             {
-                if (visible)
-                {
-                    visibleFound = true;
-                    visibleRiset->rs_risetm = time;
-                    visibleRiset->rs_riseaz = satillite.es.co_az;
-                    if (visibleRiseAlt)
-                        *visibleRiseAlt = satillite.es.co_alt;
-                }
+                *to = a;
+                return true;
             }
-            else
+            found = true;
+            *from = b;
+        }
+        prev = curr;
+        prev_time = time;
+    }
+    *to = end;
+    return found;
+}
+
+static bool SatelliteAllowsVisibility(const SatelliteSample &sample)
+{
+    return sample.alt >= VISIBLE_SATELLITE_ALT && !sample.eclipsed;
+}
+
+/* the time between a and b, which differ in visibility, where it changes.
+ * a change of altitude alone is refined with its rate, one of the shadow
+ * by bisection */
+static void RefineSatelliteVisibility(Now *now, Obj *satillite, const SatelliteGeometry &geometry, SatelliteSample a, SatelliteSample b, SatelliteSample *boundary)
+{
+    if (a.eclipsed == b.eclipsed)
+    {
+        RefineSatelliteCrossing(now, satillite, geometry, a, b, boundary, VISIBLE_SATELLITE_ALT);
+        return;
+    }
+
+    bool visible = SatelliteAllowsVisibility(a);
+    while (b.time - a.time > CROSSING_TOLERANCE)
+    {
+        SatelliteSample current;
+        if (!SampleSatellite(now, satillite, geometry, 0.5 * (a.time + b.time), &current))
+            break;
+        if (SatelliteAllowsVisibility(current) == visible)
+            a = current;
+        else
+            b = current;
+    }
+    *boundary = visible ? a : b;
+}
+
+/* first part of the pass in riset when the satellite can be seen with the
+ * naked eye: the sun between VISIBLE_SUN_ALT_MIN and VISIBLE_SUN_ALT_MAX,
+ * the satellite sunlit and above VISIBLE_SATELLITE_ALT. the sun condition
+ * is solved first from the track, and the satellite is only propagated
+ * where it holds. the highest point of that part goes in the transit
+ * fields of visibleRiset.
+ */
+static void FindSatelliteVisibility(Now *now, Obj *satillite, const RiseSet *riset, RiseSet *visibleRiset, double *visibleRiseAlt, double *visibleSetAlt)
+{
+    double orig = now->n_mjd;
+    visibleRiset->rs_flags = RS_ERROR;
+
+    SunTrack track;
+    SunTrackFor(now, riset->rs_risetm, riset->rs_settm, &track);
+
+    SatelliteGeometry geometry;
+    if (!SatelliteGeometryFor(now, satillite, &geometry))
+        return;
+
+    double from = riset->rs_risetm, to;
+    SatelliteSample rise, set;
+    bool found = false;
+    while (!found && from < riset->rs_settm && FindSunVisibility(track, from, riset->rs_settm, &from, &to))
+    {
+        SatelliteSample prev;
+        if (!SampleSatellite(now, satillite, geometry, from, &prev))
+            break;
+        if (SatelliteAllowsVisibility(prev))
+        {
+            found = true;
+            rise = prev;
+        }
+
+        set = prev;
+        while (prev.time < to)
+        {
+            SatelliteSample curr;
+            if (!SampleSatellite(now, satillite, geometry, fmin(prev.time + VISIBLE_SATELLITE_STEP, to), &curr))
+                break;
+            if (SatelliteAllowsVisibility(curr) != SatelliteAllowsVisibility(prev))
             {
-                if (!visible)
+                SatelliteSample boundary;
+                RefineSatelliteVisibility(now, satillite, geometry, prev, curr, &boundary);
+                if (found)
                 {
+                    set = boundary;
                     break;
                 }
+                found = true;
+                rise = boundary;
             }
+            prev = set = curr;
         }
-        if (visibleFound) {
-            visibleRiset->rs_settm = time;
-            visibleRiset->rs_setaz = satillite.es.co_az;
-            if (visibleSetAlt)
-                *visibleSetAlt = satillite.es.co_alt;
-            visibleRiset->rs_flags = 0;
-        } else {
-            visibleRiset->rs_flags = RS_ERROR;
-        }
+        from = to + CROSSING_TOLERANCE;
     }
+    now->n_mjd = orig;
+    if (!found)
+        return;
+
+    visibleRiset->rs_flags = 0;
+    visibleRiset->rs_risetm = rise.time;
+    visibleRiset->rs_riseaz = rise.az;
+    visibleRiset->rs_settm = set.time;
+    visibleRiset->rs_setaz = set.az;
+    if (visibleRiseAlt)
+        *visibleRiseAlt = rise.alt;
+    if (visibleSetAlt)
+        *visibleSetAlt = set.alt;
+
+    if (riset->rs_trantm >= rise.time && riset->rs_trantm <= set.time)
+    {
+        visibleRiset->rs_trantm = riset->rs_trantm;
+        visibleRiset->rs_tranaz = riset->rs_tranaz;
+        visibleRiset->rs_tranalt = riset->rs_tranalt;
+    }
+    else
+    {
+        const SatelliteSample &peak = rise.alt > set.alt ? rise : set;
+        visibleRiset->rs_trantm = peak.time;
+        visibleRiset->rs_tranaz = peak.az;
+        visibleRiset->rs_tranalt = peak.alt;
+    }
+}
+
+static int NextSatellitePass(Obj satillite, double seconds_since_epoch, double longitude, double latitude, double altitude, RiseSet* riset, RiseSet* visibleRiset, double* visibleRiseAlt, double* visibleSetAlt)
+{
+    double azimuth, elevation;
+
+    /* Construct the observer */
+    Now now;
+    ConfigureObserver(longitude, latitude, altitude, seconds_since_epoch, &now);
+    int result = GetModifiedRisetS(&now, &satillite, 1.0 / 1440 / 6, 10, riset, &elevation, &azimuth, true);
+    if (result == 0 && visibleRiset)
+        FindSatelliteVisibility(&now, &satillite, riset, visibleRiset, visibleRiseAlt, visibleSetAlt);
     return result;
 }
 
+int GetNextSatellitePass(const char* line0, const char* line1, const char* line2, double seconds_since_epoch, double longitude, double latitude, double altitude, RiseSet* riset, RiseSet* visibleRiset, double* visibleRiseAlt, double* visibleSetAlt)
+{
+    STAT_TIMER(STAT_T_SATELLITE_PASS);
+    Obj satillite;
+    /* Construct the Satellite */
+    if (db_tle((char*)line0, (char*)line1, (char*)line2, &satillite) != 0)
+        return 0;
+    return NextSatellitePass(satillite, seconds_since_epoch, longitude, latitude, altitude, riset, visibleRiset, visibleRiseAlt, visibleSetAlt);
+}
+
+int GetNextSatellitePass(const SatelliteHandle *satellite, double seconds_since_epoch, double longitude, double latitude, double altitude, RiseSet* riset, RiseSet* visibleRiset, double* visibleRiseAlt, double* visibleSetAlt)
+{
+    STAT_TIMER(STAT_T_SATELLITE_PASS);
+    if (!satellite)
+        return RS_ERROR;
+    return NextSatellitePass(satellite->obj, seconds_since_epoch, longitude, latitude, altitude, riset, visibleRiset, visibleRiseAlt, visibleSetAlt);
+}
+
+/* greatest |latitude| in radians of an observer that can see satillite above
+ * the horizon, negative if it has decayed. its ground track stays within
+ * the inclination of the equator, and even from apogee it is only above
+ * the horizon within acos(earth radius / apogee radius) of arc of it. the
+ * margin covers earth's flattening and the drag over a few days. */
+static double SatelliteReach(const Obj *satillite)
+{
+    double apogee = SatelliteApogee(satillite);
+    if (!(apogee > ERAD))
+        return -1;
+
+    double inclination = radian(satillite->es_inc);
+    if (inclination > M_PI / 2)
+        inclination = M_PI - inclination;
+    return inclination + acos(ERAD / apogee) + SATELLITE_REACH_MARGIN;
+}
+
+static void SatellitePasses(const SatelliteHandle *satellite, int index, const SatelliteObserver *observers, int observerCount, double startTime, double endTime, vector<SatellitePassRecord> &passes)
+{
+    const double step = 1.0 / 1440 / 6;
+    double slack = 1 / satellite->obj.es_n;     // a pass rising just before the end sets within a revolution
+    double end = EpochToEphemTime(endTime);
+    double reach = SatelliteReach(&satellite->obj);
+    Obj satillite = satellite->obj;
+
+    for (int i = 0; i < observerCount; i++)
+    {
+        const SatelliteObserver &observer = observers[i];
+        if (fabs(radian(observer.latitude)) > reach)
+            continue;
+
+        Now now;
+        ConfigureObserver(observer.longitude, observer.latitude, observer.altitude, startTime, &now);
+        while (now.n_mjd < end)
+        {
+            RiseSet riset;
+            double el, az;
+            if (GetModifiedRisetS(&now, &satillite, step, end - now.n_mjd + slack, &riset, &el, &az, true) != 0 || riset.rs_risetm >= end)
+                break;
+
+            SatellitePassRecord pass;
+            pass.satellite = index;
+            pass.observer = i;
+            pass.riseTime = EphemToEpochTime(riset.rs_risetm);
+            pass.setTime = EphemToEpochTime(riset.rs_settm);
+            pass.peakTime = EphemToEpochTime(riset.rs_trantm);
+            pass.riseAzimuth = riset.rs_riseaz;
+            pass.setAzimuth = riset.rs_setaz;
+            pass.peakAzimuth = riset.rs_tranaz;
+            pass.peakAltitude = riset.rs_tranalt;
+            passes.push_back(pass);
+
+            now.n_mjd = riset.rs_settm + step;
+        }
+    }
+}
+
+vector<SatellitePassRecord> GetSatellitePasses(const SatelliteHandle *const *satellites, int satelliteCount, const SatelliteObserver *observers, int observerCount, double startTime, double endTime, int threadCount)
+{
+    STAT_TIMER(STAT_T_SATELLITE_PASSES);
+    if (threadCount <= 0)
+        threadCount = (int)thread::hardware_concurrency();
+    threadCount = max(1, min(threadCount, satelliteCount));
+
+    /* each thread takes the next satellite until none are left, with all
+     * observers, so the handle is only read by one thread at a time and
+     * the ephemeris caches, being per thread, need no locking */
+    atomic<int> next(0);
+    vector<vector<SatellitePassRecord>> results(threadCount);
+    auto work = [&](int t) {
+        int i;
+        while ((i = next++) < satelliteCount)
+        {
+            if (satellites[i])
+                SatellitePasses(satellites[i], i, observers, observerCount, startTime, endTime, results[t]);
+        }
+    };
+
+    /* a thread that cannot be started leaves its share to the others, this
+     * one included, as they all take from next */
+    vector<thread> threads;
+    threads.reserve(threadCount - 1);
+    for (int t = 1; t < threadCount; t++)
+    {
+        try {
+            threads.emplace_back(work, t);
+        } catch (const system_error &) {
+            break;
+        }
+    }
+    work(0);
+    for (auto &t : threads)
+        t.join();
+
+    vector<SatellitePassRecord> passes;
+    for (auto &result : results)
+        passes.insert(passes.end(), result.begin(), result.end());
+    sort(passes.begin(), passes.end(), [](const SatellitePassRecord &a, const SatellitePassRecord &b) {
+        if (a.satellite != b.satellite)
+            return a.satellite < b.satellite;
+        if (a.observer != b.observer)
+            return a.observer < b.observer;
+        return a.riseTime < b.riseTime;
+    });
+    return passes;
+}
+
 int GetSunStatus(double altitude, bool isGoingUp, bool hasUpAndDown)
 {
     int state = 0;
@@ -478,72 +1785,570 @@ int GetSunStatus(double altitude, bool isGoingUp, bool hasUpAndDown)
 }
 
 
+#define SUN_DETAILS_STEP          (1.0 / HOURS_PER_DAY)
+#define SUN_DETAILS_UNKNOWN_SPAN  (20.0 / SECONDS_PER_DAY)
+
+static const double sunThresholds[] = { -18, -12, -6, -4, 0, 6 };
+
+struct SunEvent {
+    double time;
+    double altitude;    // degrees, right after the event
+    bool isGoingUp;
+    bool isTurn;        // altitude extremum rather than a threshold crossing
+};
+
+static void AddSunPeriod(std::vector<TimePeriod> &periods, double start, double end, double origin, int status)
+{
+    if (end > start)
+    {
+        TimePeriod period {(start - origin) * SECONDS_PER_DAY, (end - origin) * SECONDS_PER_DAY, status};
+        periods.push_back(period);
+    }
+}
+
 std::vector<TimePeriod> GetSunDetails(double longitude, double latitude, double altitude, double startTime, double endTime)
 {
+    STAT_TIMER(STAT_T_SUN_DETAILS);
     std::vector<TimePeriod> periods;
-    double currentTime = startTime;
-    double step = 20;
+    if (endTime < startTime)
+        return periods;
+
+    Now now;
+    ConfigureObserver(longitude, latitude, altitude, startTime, &now);
+
+    Obj *objs;
+    getBuiltInObjs(&objs);
+    Obj sunObj = objs[SUN];
+
+    double start = EpochToEphemTime(startTime);
+    double end = EpochToEphemTime(endTime);
+
+    // hourly samples, one beyond each end so extrema near the ends are bracketed
+    std::vector<std::pair<double, double>> samples;
+    for (int i = -1;; i++)
+    {
+        double time = start + i * SUN_DETAILS_STEP;
+        samples.emplace_back(time, AltitudeAt(&now, &sunObj, time, NULL));
+        if (time > end)
+            break;
+    }
 
-    int currentStatus = 0;
-    double currentStartTime = 0;
+    // altitude is monotonic between consecutive points
+    std::vector<std::pair<double, double>> points;
+    std::vector<SunEvent> events;
+    points.emplace_back(start, AltitudeAt(&now, &sunObj, start, NULL));
+    points.emplace_back(end, AltitudeAt(&now, &sunObj, end, NULL));
+    for (size_t i = 1; i + 1 < samples.size(); i++)
+    {
+        double prev = samples[i - 1].second, curr = samples[i].second, next = samples[i + 1].second;
+        bool isMax = prev < curr && curr >= next;
+        bool isMin = prev > curr && curr <= next;
+
+        if (samples[i].first > start && samples[i].first < end)
+            points.push_back(samples[i]);
+        if (!isMax && !isMin)
+            continue;
+
+        double alt, az;
+        double time = FindAltitudeExtremum(&now, &sunObj, samples[i - 1].first, samples[i + 1].first, isMax, &alt, &az);
+        if (time > start && time < end)
+        {
+            points.emplace_back(time, alt);
+            events.push_back({time, alt / M_PI * 180, isMin, true});
+        }
+    }
+    sort(points.begin(), points.end());
+
+    for (size_t i = 0; i + 1 < points.size(); i++)
+    {
+        double a = points[i].first, fa = points[i].second;
+        double b = points[i + 1].first, fb = points[i + 1].second;
+        for (double threshold : sunThresholds)
+        {
+            double x = radian(threshold);
+            bool up = fa <= x && fb > x;
+            bool down = fa > x && fb <= x;
+            if (!up && !down)
+                continue;
+
+            double time = RefineCrossing(&now, &sunObj, a, fa - x, b, fb - x, x, NULL);
+            // the band right above a threshold starts just past it
+            events.push_back({time, up ? threshold + 1e-6 : threshold, up, false});
+        }
+    }
+    sort(events.begin(), events.end(), [](const SunEvent &l, const SunEvent &r) { return l.time < r.time; });
 
-    double currentAltitude = 0.0;
-    bool isCurrentAltitudeValid = false;
-    bool isGoingUp = false;
-    bool isGoingUpValid = false;
+    // same state machine as the original 20 s sampler, driven by events
+    bool isGoingUp = points[1].second >= points[0].second;
     bool hasUpAndDown = false;
+    int currentStatus = GetSunStatus(points[0].second / M_PI * 180, isGoingUp, false);
+    double currentStartTime = start;
 
-    currentTime -= step;
-    while (currentTime <= endTime)
-    {
-        Now current;
-        ConfigureObserver(longitude, latitude, altitude, currentTime, &current);
-
-        Obj sunObj;
-        sunObj.pl.plo_code = SUN;
-        sunObj.any.co_type = PLANET;
-        obj_cir(&current, &sunObj);
-        double sunAltitude = sunObj.pl.co_alt / M_PI * 180;
-        if (!isCurrentAltitudeValid) {
-            currentAltitude = sunAltitude;
-            isCurrentAltitudeValid = true;
-        } else {
-            bool isCurrentlyGoingUp = sunAltitude >= currentAltitude;
-            if (!isGoingUpValid) {
-                isGoingUp = isCurrentlyGoingUp;
-                isGoingUpValid = true;
-            } else {
-                if (!hasUpAndDown && (isGoingUp != isCurrentlyGoingUp)) {
-                    hasUpAndDown = true;
-                }
-                isGoingUp = isCurrentlyGoingUp;
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const SunEvent &event = events[i];
+        if (event.isTurn)
+            hasUpAndDown = true;
+        isGoingUp = event.isGoingUp;
+
+        int status = GetSunStatus(event.altitude, isGoingUp, hasUpAndDown);
+        if (status == currentStatus)
+            continue;
+
+        AddSunPeriod(periods, currentStartTime, event.time, start, currentStatus);
+        currentStartTime = event.time;
+        currentStatus = status;
+
+        if (hasUpAndDown)
+        {
+            // the sampler reported an UNKNOWN state for the single sample
+            // after the sun turned, keep that span so the lists line up
+            double unknownEnd = i + 1 < events.size() ? events[i + 1].time : end;
+            unknownEnd = fmin(unknownEnd, event.time + SUN_DETAILS_UNKNOWN_SPAN);
+            int next = GetSunStatus(event.altitude, isGoingUp, false);
+            if (next != status)
+            {
+                AddSunPeriod(periods, currentStartTime, unknownEnd, start, currentStatus);
+                currentStartTime = unknownEnd;
+                currentStatus = next;
             }
-            currentAltitude = sunAltitude;
+            hasUpAndDown = false;
         }
-        if (isGoingUpValid)
+    }
+
+    TimePeriod period {(currentStartTime - start) * SECONDS_PER_DAY, endTime - startTime, currentStatus};
+    periods.push_back(period);
+    return periods;
+}
+
+#define ALMANAC_MOON_STEP       (1.0 / 3)   /* days between evaluations of the moon */
+#define ALMANAC_SUN_EVERY       3           /* moon evaluations to one of the sun */
+#define TRACK_SCAN_STEP         (1.0 / MINUTES_PER_DAY)
+#define TRACK_TRANSIT_TOLERANCE (0.1 / SECONDS_PER_DAY)
+#define SOLAR_DAY               1.0
+#define LUNAR_DAY               1.0351  /* mean interval of moonrises, 24h 50.5m */
+
+/* an observer as cir_pos() sees one */
+struct TrackSite
+{
+    double longitude;           // rad
+    double latitude, height;    // rad, earth radii
+    double sinLat, cosLat;
+    double xobs, zobs;          // observer off the earth's axis and equator, earth radii, as ta_par() has it
+    double airPressure, airTemp;
+};
+
+static void TrackSiteFor(double longitude, double latitude, double height, double airPressure, double airTemp, TrackSite *site)
+{
+    site->longitude = longitude;
+    site->latitude = latitude;
+    site->height = height;
+    site->sinLat = sin(latitude);
+    site->cosLat = cos(latitude);
+
+    double e2 = (2 - 1 / 298.257) / 298.257;
+    double robs = 1 / sqrt(1 - e2 * site->sinLat * site->sinLat);
+    site->xobs = (robs + height) * site->cosLat;
+    site->zobs = (robs * (1 - e2) + height) * site->sinLat;
+    site->airPressure = airPressure;
+    site->airTemp = airTemp;
+}
+
+/* the body at geocentric hour angle ha, declination dec and distance rho,
+ * earth radii, as seen from site: x towards the meridian, y east and z
+ * north, earth radii. the same parallax as ta_par() */
+static void SiteVector(const TrackSite &site, double ha, double dec, double rho, double v[3])
+{
+    double cd = cos(dec);
+    v[0] = rho * cd * cos(ha) - site.xobs;
+    v[1] = -rho * cd * sin(ha);
+    v[2] = rho * sin(dec) - site.zobs;
+}
+
+/* sine of the unrefracted altitude of v */
+static double SiteSinAltitude(const TrackSite &site, const double v[3])
+{
+    return (v[0] * site.cosLat + v[2] * site.sinLat) / sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+/* refracted altitude and azimuth of v, as hadec_aa() and refract() */
+static void SiteHorizon(const TrackSite &site, const double v[3], double *alt, double *az)
+{
+    double up = v[0] * site.cosLat + v[2] * site.sinLat;
+    double north = v[2] * site.cosLat - v[0] * site.sinLat;
+    double east = v[1];
+
+    refract(site.airPressure, site.airTemp, atan2(up, hypot(north, east)), alt);
+    *az = atan2(east, north);
+    if (*az < 0)
+        *az += 2 * M_PI;
+}
+
+/* geocentric distance of obj, just reduced for site at local sidereal time
+ * lst, in earth radii. s_edist is from the observer; this is the other side
+ * of the triangle with the observer along the apparent direction */
+static double GeocentricDistance(const TrackSite &site, double lst, const Obj *obj)
+{
+    double dec = obj->s_gaedec;
+    double topo = obj->s_edist * MAU / ERAD;
+    double along = site.xobs * cos(dec) * cos(lst - obj->s_gaera) + site.zobs * sin(dec);
+    double off = site.xobs * site.xobs + site.zobs * site.zobs;
+    return along + sqrt(along * along - off + topo * topo);
+}
+
+/* a body's apparent geocentric place every step days over a range,
+ * interpolated in between and carried to any site's altitude the way
+ * cir_pos() does, so solving for an event evaluates no theory */
+struct BodyTrack
+{
+    double start, step;
+    double own;                 // bound of the body's own part of |d alt / dt|, rad/day
+    vector<double> ra, dec;     // ra unwrapped, rad
+    vector<double> distance;    // earth radii
+    vector<double> gst;         // apparent sidereal time at greenwich, rad
+};
+
+struct TrackPlace
+{
+    double alt, az;
+    double ha;                  // topocentric
+};
+
+static void BodyTrackFor(BodyTrack *track, double start, double step, double own)
+{
+    track->start = start;
+    track->step = step;
+    track->own = own;
+}
+
+/* add the place of obj, just reduced at tc for site, as the track's next node */
+static void BodyTrackAdd(BodyTrack *track, const TimeCtx *tc, const TrackSite &site, const Obj *obj)
+{
+    double ra = obj->s_gaera;
+    if (!track->ra.empty())
+        ra = track->ra.back() + remainder(ra - track->ra.back(), 2 * M_PI);
+
+    double gst = hrrad(tc->tc_gast);
+    track->ra.push_back(ra);
+    track->dec.push_back(obj->s_gaedec);
+    track->distance.push_back(GeocentricDistance(site, gst + site.longitude, obj));
+    track->gst.push_back(gst);
+}
+
+/* the body as seen from site at time, as SiteVector */
+static void TrackVector(const BodyTrack &track, const TrackSite &site, double time, double v[3])
+{
+    int n = (int)track.ra.size();
+    double u = (time - track.start) / track.step;
+    int i = min(max((int)floor(u), 1), n - 3);
+    double f = u - i;
+
+    /* cubic through nodes i - 1 to i + 2 */
+    double w0 = -f * (f - 1) * (f - 2) / 6;
+    double w1 = (f + 1) * (f - 1) * (f - 2) / 2;
+    double w2 = -(f + 1) * f * (f - 2) / 2;
+    double w3 = (f + 1) * f * (f - 1) / 6;
+    auto cubic = [&](const vector<double> &x) { return w0 * x[i - 1] + w1 * x[i] + w2 * x[i + 1] + w3 * x[i + 2]; };
+
+    double lst = track.gst[i] + site.longitude + f * track.step * 2 * M_PI / SIDRATE;
+    SiteVector(site, lst - cubic(track.ra), cubic(track.dec), cubic(track.distance), v);
+}
+
+static void TrackPlaceAt(const BodyTrack &track, const TrackSite &site, double time, TrackPlace *place)
+{
+    double v[3];
+    TrackVector(track, site, time, v);
+    SiteHorizon(site, v, &place->alt, &place->az);
+    place->ha = atan2(-v[1], v[0]);
+}
+
+/* sine of the unrefracted altitude, which is all the searches need: the
+ * threshold is unrefracted instead, once per event */
+static double TrackSinAltitude(const BodyTrack &track, const TrackSite &site, double time)
+{
+    double v[3];
+    TrackVector(track, site, time, v);
+    return SiteSinAltitude(site, v);
+}
+
+/* first time the body crosses x, a sine of the unrefracted altitude, going
+ * up or down within [from, to), 0 if it does not, walking in jumps no
+ * crossing can hide in as FindAltXBracket does */
+static double TrackScan(const BodyTrack &track, const TrackSite &site, double x, bool rising, double from, double to)
+{
+    auto f = [&](double time) { return TrackSinAltitude(track, site, time) - x; };
+    double rate = 2 * M_PI / SIDRATE * fabs(site.cosLat) + track.own;
+
+    double prev_time = from, prev = f(from);
+    while (prev_time < to)
+    {
+        double current = fmin(to, prev_time + fmax(fabs(prev) / rate, TRACK_SCAN_STEP));
+        double curr = f(current);
+        if (rising ? prev <= 0 && curr > 0 : prev > 0 && curr <= 0)
+            return BrentRoot(f, prev_time, prev, current, curr);
+        prev = curr;
+        prev_time = current;
+    }
+    return 0;
+}
+
+/* as TrackScan, but first trying the window around guess, if any, where
+ * the crossing is expected; only the part of the day before the window then
+ * needs walking, in case the body crosses twice that day */
+static double TrackCrossing(const BodyTrack &track, const TrackSite &site, double x, bool rising, double from, double to, double guess, double window)
+{
+    if (guess)
+    {
+        auto f = [&](double time) { return TrackSinAltitude(track, site, time) - x; };
+        double a = fmax(from, guess - window), b = fmin(to, guess + window);
+        double fa = f(a), fb = f(b);
+        if (a < b && (rising ? fa <= 0 && fb > 0 : fa > 0 && fb <= 0))
         {
-            int status = GetSunStatus(sunAltitude, isGoingUp, hasUpAndDown);
-            if (status != currentStatus)
+            double earlier = a > from ? TrackScan(track, site, x, rising, from, a) : 0;
+            if (earlier)
+                return earlier;
+            return BrentRoot(f, a, fa, b, fb);
+        }
+    }
+    return TrackScan(track, site, x, rising, from, to);
+}
+
+/* time the body passes the upper meridian within [from, to), 0 if it does
+ * not, by Newton's method on the hour angle from its value at from */
+static double TrackTransit(const BodyTrack &track, const TrackSite &site, double from, double to, double motion, TrackPlace *place)
+{
+    double rate = 2 * M_PI / SIDRATE - motion;
+    TrackPlaceAt(track, site, from, place);
+
+    double time = from + (2 * M_PI - fmod2(place->ha, 2 * M_PI)) / rate;
+    for (int iter = 0; iter < 10; iter++)
+    {
+        TrackPlaceAt(track, site, time, place);
+        double dt = remainder(place->ha, 2 * M_PI) / rate;
+        time -= dt;
+        if (fabs(dt) < TRACK_TRANSIT_TOLERANCE)
+            break;
+    }
+    if (time < from || time >= to)
+        return 0;
+    TrackPlaceAt(track, site, time, place);
+    return time;
+}
+
+struct AlmanacEvent
+{
+    bool moon;
+    double altitude;            // degrees
+    bool rising;
+    double AlmanacDay::*time;
+    double AlmanacDay::*azimuth;
+};
+
+static const AlmanacEvent almanacEvents[] = {
+    { false, 0, true, &AlmanacDay::sunRise, &AlmanacDay::sunRiseAzimuth },
+    { false, 0, false, &AlmanacDay::sunSet, &AlmanacDay::sunSetAzimuth },
+    { false, -6, true, &AlmanacDay::civilDawn, NULL },
+    { false, -6, false, &AlmanacDay::civilDusk, NULL },
+    { false, -12, true, &AlmanacDay::nauticalDawn, NULL },
+    { false, -12, false, &AlmanacDay::nauticalDusk, NULL },
+    { false, -18, true, &AlmanacDay::astronomicalDawn, NULL },
+    { false, -18, false, &AlmanacDay::astronomicalDusk, NULL },
+    { true, 0, true, &AlmanacDay::moonRise, &AlmanacDay::moonRiseAzimuth },
+    { true, 0, false, &AlmanacDay::moonSet, &AlmanacDay::moonSetAzimuth },
+};
+
+#define NALMANACEVENTS  (sizeof(almanacEvents) / sizeof(almanacEvents[0]))
+
+vector<AlmanacDay> GetAlmanac(double longitude, double latitude, double altitude, double startTime, int days)
+{
+    STAT_TIMER(STAT_T_ALMANAC);
+    vector<AlmanacDay> almanac;
+    if (days <= 0)
+        return almanac;
+
+    Now now;
+    ConfigureObserver(longitude, latitude, altitude, startTime, &now);
+
+    Obj *objs;
+    getBuiltInObjs(&objs);
+    Obj sunObj = objs[SUN], moonObj = objs[MOON];
+
+    /* both tracks from one sun and moon reduction per instant, the sun on
+     * every ALMANAC_SUN_EVERY-th, with two nodes to spare at each end */
+    double start = EpochToEphemTime(startTime);
+    double sunStep = ALMANAC_MOON_STEP * ALMANAC_SUN_EVERY;
+    double first = start - sunStep;
+    int sunNodes = (int)ceil(days / sunStep) + 4;
+    int moonNodes = (sunNodes - 1) * ALMANAC_SUN_EVERY + 1;
+
+    TrackSite site;
+    TrackSiteFor(now.n_lng, now.n_lat, now.n_elev, now.n_pressure, now.n_temp, &site);
+
+    BodyTrack sunTrack, moonTrack;
+    BodyTrackFor(&sunTrack, first, sunStep, 0.05);
+    BodyTrackFor(&moonTrack, first, ALMANAC_MOON_STEP, 0.4);
+
+    TimeCtx tc;
+    for (int i = 0; i < moonNodes; i++)
+    {
+        now.n_mjd = first + i * ALMANAC_MOON_STEP;
+        time_ctx(&now, &tc);
+        obj_cir_ctx(&now, &tc, &moonObj);
+        BodyTrackAdd(&moonTrack, &tc, site, &moonObj);
+        if (i % ALMANAC_SUN_EVERY == 0)
+        {
+            obj_cir_ctx(&now, &tc, &sunObj);
+            BodyTrackAdd(&sunTrack, &tc, site, &sunObj);
+        }
+    }
+
+    /* each event is first looked for where the last one, moved on by the
+     * interval between the last two, would put it */
+    double last[NALMANACEVENTS] = {}, interval[NALMANACEVENTS], threshold[NALMANACEVENTS];
+    for (size_t k = 0; k < NALMANACEVENTS; k++)
+    {
+        interval[k] = almanacEvents[k].moon ? LUNAR_DAY : SOLAR_DAY;
+        unrefract(now.n_pressure, now.n_temp, radian(almanacEvents[k].altitude), &threshold[k]);
+        threshold[k] = sin(threshold[k]);
+    }
+
+    almanac.reserve(days);
+    for (int d = 0; d < days; d++)
+    {
+        double dayStart = start + d, dayEnd = dayStart + 1;
+        AlmanacDay day = {};
+        day.start = EphemToEpochTime(dayStart);
+
+        for (size_t k = 0; k < NALMANACEVENTS; k++)
+        {
+            const AlmanacEvent &event = almanacEvents[k];
+            const BodyTrack &track = event.moon ? moonTrack : sunTrack;
+            double nominal = event.moon ? LUNAR_DAY : SOLAR_DAY;
+
+            double guess = 0;
+            if (last[k])
+                for (guess = last[k] + interval[k]; guess < dayStart; guess += interval[k])
+                    ;
+            double time = TrackCrossing(track, site, threshold[k], event.rising, dayStart, dayEnd, guess, nominal / 16);
+            if (!time)
+                continue;
+
+            if (last[k] && time - last[k] > 0.8 * nominal && time - last[k] < 1.25 * nominal)
+                interval[k] = time - last[k];
+            last[k] = time;
+
+            day.*event.time = EphemToEpochTime(time);
+            if (event.azimuth)
             {
-                if (currentStatus)
-                {
-                    TimePeriod period {currentStartTime - startTime,currentTime - startTime, currentStatus};
-                    periods.push_back(period);
-                }
-                currentStartTime = currentTime;
-                currentStatus = status;
-                hasUpAndDown = false;
+                TrackPlace place;
+                TrackPlaceAt(track, site, time, &place);
+                day.*event.azimuth = place.az;
             }
         }
-        currentTime += step;
+
+        TrackPlace place;
+        double time = TrackTransit(sunTrack, site, dayStart, dayEnd, 2 * M_PI / 365.2422, &place);
+        if (time)
+        {
+            day.sunTransit = EphemToEpochTime(time);
+            day.sunTransitAzimuth = place.az;
+            day.sunTransitAltitude = place.alt;
+        }
+        time = TrackTransit(moonTrack, site, dayStart, dayEnd, 2 * M_PI / 27.3217, &place);
+        if (time)
+        {
+            day.moonTransit = EphemToEpochTime(time);
+            day.moonTransitAzimuth = place.az;
+            day.moonTransitAltitude = place.alt;
+        }
+        almanac.push_back(day);
     }
+    return almanac;
+}
 
-    if (currentStatus)
+#define SITE_PLANET_STEP        1.0     /* days between evaluations of other than the moon */
+
+void GetSitePositions(int index, double time, const SiteGrid *sites, SkyPositions *positions)
+{
+    STAT_TIMER(STAT_T_SITE_POSITIONS);
+    Obj *objs;
+    getBuiltInObjs(&objs);
+    Obj obj = objs[index];
+
+    /* the body once, from the centre of the map; what is left depends on the
+     * site and is the same parallax, hour angle and refraction cir_pos()
+     * would work out for it */
+    Now now;
+    ConfigureObserver(0, 0, 0, time, &now);
+    TimeCtx tc;
+    time_ctx(&now, &tc);
+    obj_cir_ctx(&now, &tc, &obj);
+
+    TrackSite origin;
+    TrackSiteFor(now.n_lng, now.n_lat, now.n_elev, now.n_pressure, now.n_temp, &origin);
+    double gst = hrrad(tc.tc_gast);
+    double distance = GeocentricDistance(origin, gst + origin.longitude, &obj);
+
+    for (int i = 0; i < sites->count; i++)
     {
-        TimePeriod period {currentStartTime - startTime,endTime - startTime, currentStatus};
-        periods.push_back(period);
+        TrackSite site;
+        TrackSiteFor(radian(sites->longitude[i]), radian(sites->latitude[i]), sites->altitude[i] / ERAD, now.n_pressure, now.n_temp, &site);
+
+        double v[3], alt, az;
+        SiteVector(site, gst + site.longitude - obj.s_gaera, obj.s_gaedec, distance, v);
+        SiteHorizon(site, v, &alt, &az);
+        if (positions->alt)
+            positions->alt[i] = alt;
+        if (positions->az)
+            positions->az[i] = az;
+    }
+}
+
+void GetSiteRisets(int index, double startTime, double endTime, const SiteGrid *sites, double *riseTime, double *setTime)
+{
+    STAT_TIMER(STAT_T_SITE_RISETS);
+    Obj *objs;
+    getBuiltInObjs(&objs);
+    Obj obj = objs[index];
+
+    Now now;
+    ConfigureObserver(0, 0, 0, startTime, &now);
+    TrackSite origin;
+    TrackSiteFor(now.n_lng, now.n_lat, now.n_elev, now.n_pressure, now.n_temp, &origin);
+
+    /* one track for all sites, with two nodes to spare at each end */
+    double start = EpochToEphemTime(startTime);
+    double end = EpochToEphemTime(max(startTime, endTime));
+    double step = index == MOON ? ALMANAC_MOON_STEP : SITE_PLANET_STEP;
+    int nodes = (int)ceil((end - start) / step) + 4;
+
+    BodyTrack track;
+    BodyTrackFor(&track, start - step, step, index == MOON ? 0.4 : 0.05);
+    TimeCtx tc;
+    for (int i = 0; i < nodes; i++)
+    {
+        now.n_mjd = track.start + i * step;
+        time_ctx(&now, &tc);
+        obj_cir_ctx(&now, &tc, &obj);
+        BodyTrackAdd(&track, &tc, origin, &obj);
+    }
+
+    double horizon;
+    unrefract(now.n_pressure, now.n_temp, 0, &horizon);
+    horizon = sin(horizon);
+
+    for (int i = 0; i < sites->count; i++)
+    {
+        TrackSite site;
+        TrackSiteFor(radian(sites->longitude[i]), radian(sites->latitude[i]), sites->altitude[i] / ERAD, now.n_pressure, now.n_temp, &site);
+
+        double rise = TrackScan(track, site, horizon, true, start, end);
+        double set = TrackScan(track, site, horizon, false, start, end);
+        if (riseTime)
+            riseTime[i] = rise ? EphemToEpochTime(rise) : 0;
+        if (setTime)
+            setTime[i] = set ? EphemToEpochTime(set) : 0;
     }
-    return periods;
 }
 
 astro::Date::Date() : Date(0, 0, 0)
@@ -603,7 +2408,7 @@ astro::Date::Date(double jd)
 
 const char* astro::Date::toCStr(Format format) const
 {
-    static char date[255];
+    static thread_local char date[255];
 
     if (format == ISO8601)
     {
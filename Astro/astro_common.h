@@ -29,29 +29,224 @@ extern "C" {
 #define STATUS_NAUTICAL_UNKNOWN       16
 #define STATUS_ASTRONOMICAL_UNKNOWN   17
 
+#define RISET_SOLVER_SCAN             0 /* fixed steps, midpoint of the bracketing step */
+#define RISET_SOLVER_BRACKET          1 /* adaptive bracketing refined by Brent's method */
+
+#define MOON_PHASE_NEW                0
+#define MOON_PHASE_FIRST_QUARTER      1
+#define MOON_PHASE_FULL               2
+#define MOON_PHASE_LAST_QUARTER       3
+
+struct MoonPhaseEvent {
+    double time;    // seconds since 1970
+    int phase;      // MOON_PHASE_*
+};
+
 struct TimePeriod {
     double start;
     double end;
     int status;
 };
 
+// structure-of-arrays output of GetSkyPositions, objectCount * timeCount
+// entries each, all instants of the first object first. null arrays are skipped.
+struct SkyPositions {
+    double *alt;        // radians
+    double *az;         // radians
+    double *ra;         // radians
+    double *dec;        // radians
+    double *distance;   // from earth, AU
+    double *magnitude;
+};
+
+// structure-of-arrays star catalog for GetStarRisets, count entries each.
+// ra and dec in degrees, proper motions in milliarcseconds per year of ra and
+// dec themselves, counted from J2000 as in getStarPosition. null proper motion
+// arrays are taken as zero
+struct StarCatalog {
+    const double *ra;
+    const double *dec;
+    const double *pmRA;
+    const double *pmDec;
+    int count;
+};
+
+// structure-of-arrays output of GetStarRisets, count entries each. times in
+// seconds since 1970, angles in radians, status as riset(). rise and set are
+// those of the first setting after now, transit the one between them; all
+// three are 0 unless status is 0, except transit is the next one for stars
+// that never set. null arrays are skipped.
+struct StarRisets {
+    double *riseTime;
+    double *setTime;
+    double *transitTime;
+    double *riseAz;
+    double *setAz;
+    double *transitAz;
+    double *transitAlt;
+    double *currentAz;
+    double *currentAlt;
+    int *status;
+};
+
+// J2000 catalog place to place at one instant for TransformStars. earth and
+// deflection bend light passing the sun as deflect(), in J2000; rotation then
+// takes in precession and nutation, and aberration is the annual aberration
+// of ab_eq() added to the rotated unit vector; horizon last turns apparent
+// equatorial of date into north, east, up for the observer
+struct StarTransform {
+    double earth[3];        // unit vector from the sun
+    double deflection;
+    double rotation[3][3];
+    double aberration[3];
+    double horizon[3][3];
+    double years;           // since J2000, for proper motion
+    double airPressure;     // for refraction, as ConfigureObserver
+    double airTemp;
+};
+
 double radian(const double degree);
 double EpochToEphemTime(double seconds_since_epoch);
 double EphemToEpochTime(double ephem);
-int GetModifiedRisetS(Now *now, Obj *obj, double step, double limit, RiseSet *riset, double *el, double *az, bool up);
-int GetModifiedRiset(Now *now, int index, RiseSet *riset, double *el, double *az, bool up);
+int GetModifiedRisetS(Now *now, Obj *obj, double step, double limit, RiseSet *riset, double *el, double *az, bool up, int solver = RISET_SOLVER_BRACKET);
+int GetModifiedRiset(Now *now, int index, RiseSet *riset, double *el, double *az, bool up, int solver = RISET_SOLVER_BRACKET);
 const char *GetStarName(int index);
 void ConfigureObserver(double longitude, double latitude, double altitude, double seconds_since_epoch, Now *obj);
 double FindMoonPhase(double seconds_since_epoch, double motion, double target);
 double CurrentMoonPhase(double seconds_since_epoch);
+// principal phases from a table shared by all threads, computed once and
+// grown as later or earlier times are asked for. events in [startTime, endTime)
+// in order, or the time of the first one of phase, -1 for any, after (or at or
+// before, going back) seconds_since_epoch. times that are not finite give no
+// events, and they or a phase other than -1 or MOON_PHASE_* give NAN
+std::vector<MoonPhaseEvent> GetMoonPhaseEvents(double startTime, double endTime);
+double FindMoonPhaseEvent(double seconds_since_epoch, int phase, bool forward);
 void GetRADECRiset(double ra, double dec, double longitude, double latitude, double now, double *riseTime, double *setTime, double *transitTime, int *status, double *az_r, double *az_s, double *az_c, double *az_t, double *el_c, double *el_t);
 double GetLST(double now, double longitude);
-int FindAltXSun(Now *now, double step, double limit, int forward, int go_down, double *jd, double x);
+void GetStarRisets(const StarCatalog *stars, double longitude, double latitude, double now, StarRisets *risets);
+void GetStarTransform(double longitude, double latitude, double altitude, double now, StarTransform *transform);
+// apparent ra and dec and refracted alt and az of every star, positions
+// holding stars->count entries each; distance and magnitude are not set
+void TransformStars(const StarTransform *transform, const StarCatalog *stars, SkyPositions *positions);
+int WarmEphemerisCache(double startTime, double endTime, double tolerance);
+int WriteEphemerisFile(const char *path, double startTime, double endTime, double tolerance);
+int LoadEphemerisFile(const char *path);
+int LoadDeltaTFile(const char *path);
+void GetSkyPositions(const int *indices, int objectCount, const double *times, int timeCount, double longitude, double latitude, double altitude, SkyPositions *positions);
+int FindAltXSun(Now *now, double step, double limit, int forward, int go_down, double *jd, double x, int solver = RISET_SOLVER_BRACKET);
 int GetSatellitePosition(const char* line0, const char* line1, const char* line2, double longitude, double latitude, double altitude, double seconds_since_epoch, double* el, double* az);
 int GetSatelliteStatus(const char* line0, const char* line1, const char* line2, double seconds_since_epoch, double* sublng, double* sublat, double* elevation);
+// visibleRiset, if given, gets the first naked-eye visible part of the pass, with its
+// highest point in the transit fields; rs_flags is RS_ERROR when there is none
 int GetNextSatellitePass(const char* line0, const char* line1, const char* line2, double seconds_since_epoch, double longitude, double latitude, double altitude, RiseSet* riset, RiseSet* visibleRiset, double* visibleRiseAlt, double* visibleSetAlt);
+
+// parsed TLE with its propagator already initialised, immutable once created.
+// a null handle, as CreateSatelliteHandle gives for a bad TLE, makes the
+// calls below fail: 0 from position and status, RS_ERROR from the pass
+struct SatelliteHandle;
+
+SatelliteHandle *CreateSatelliteHandle(const char* line0, const char* line1, const char* line2);
+void DestroySatelliteHandle(SatelliteHandle *satellite);
+int GetSatellitePosition(const SatelliteHandle *satellite, double longitude, double latitude, double altitude, double seconds_since_epoch, double* el, double* az);
+int GetSatelliteStatus(const SatelliteHandle *satellite, double seconds_since_epoch, double* sublng, double* sublat, double* elevation);
+int GetNextSatellitePass(const SatelliteHandle *satellite, double seconds_since_epoch, double longitude, double latitude, double altitude, RiseSet* riset, RiseSet* visibleRiset, double* visibleRiseAlt, double* visibleSetAlt);
+
+// observer of GetSatellitePasses, degrees and meters
+struct SatelliteObserver {
+    double longitude;
+    double latitude;
+    double altitude;
+};
+
+// one pass found by GetSatellitePasses. times in seconds since 1970, angles in radians
+struct SatellitePassRecord {
+    int satellite;          // index into satellites
+    int observer;           // index into observers
+    double riseTime;
+    double setTime;
+    double peakTime;
+    double riseAzimuth;
+    double setAzimuth;
+    double peakAzimuth;
+    double peakAltitude;
+};
+
+// all passes rising within [startTime, endTime) of every satellite over every
+// observer, ordered by satellite, observer and rise time. satellites are shared
+// out over threadCount threads, 0 for one per core; pairs whose orbit never
+// gets above the observer's horizon are skipped without propagating
+std::vector<SatellitePassRecord> GetSatellitePasses(const SatelliteHandle *const *satellites, int satelliteCount, const SatelliteObserver *observers, int observerCount, double startTime, double endTime, int threadCount = 0);
+
 std::vector<TimePeriod> GetSunDetails(double longitude, double latitude, double altitude, double startTime, double endTime);
 
+// the events of one day of GetAlmanac. times in seconds since 1970, 0 where
+// the day has no such event; angles in radians. rise and set are the apparent
+// centre crossing the horizon, as GetModifiedRiset has them, and transit is
+// the passage over the upper meridian, as almanacs give it. that is not
+// GetModifiedRiset's transit, the highest altitude: as the body's declination
+// changes the two differ, by up to some 20 seconds for the sun and several
+// minutes for the moon at mid latitudes
+struct AlmanacDay {
+    double start;               // of the day
+    double sunRise;
+    double sunSet;
+    double sunTransit;
+    double sunRiseAzimuth;
+    double sunSetAzimuth;
+    double sunTransitAzimuth;
+    double sunTransitAltitude;
+    double civilDawn;           // sun at -6 degrees
+    double civilDusk;
+    double nauticalDawn;        // -12 degrees
+    double nauticalDusk;
+    double astronomicalDawn;    // -18 degrees
+    double astronomicalDusk;
+    double moonRise;
+    double moonSet;
+    double moonTransit;
+    double moonRiseAzimuth;
+    double moonSetAzimuth;
+    double moonTransitAzimuth;
+    double moonTransitAltitude;
+};
+
+// the almanac of days days from startTime, day d running from startTime +
+// d * 86400 for 86400 seconds. the sun and the moon are evaluated a few
+// times a day for the whole range and every event is solved from those
+std::vector<AlmanacDay> GetAlmanac(double longitude, double latitude, double altitude, double startTime, int days);
+
+// structure-of-arrays observers of GetSitePositions and GetSiteRisets, count
+// entries each, degrees and meters as ConfigureObserver
+struct SiteGrid {
+    const double *longitude;
+    const double *latitude;
+    const double *altitude;
+    int count;
+};
+
+// refracted altitude and azimuth of body index at time from every site, in
+// positions->alt and az, sites->count entries each; the rest of positions is
+// not set. the body's apparent geocentric place is found once, and only the
+// parallax, hour angle and refraction are worked out for each site
+void GetSitePositions(int index, double time, const SiteGrid *sites, SkyPositions *positions);
+// first rising and setting of body index within [startTime, endTime) from
+// every site, seconds since 1970, 0 where there is none. the body is evaluated
+// a few times a day over the range for all sites together, as GetAlmanac.
+// null arrays are skipped
+void GetSiteRisets(int index, double startTime, double endTime, const SiteGrid *sites, double *riseTime, double *setTime);
+
+// computes everything on this thread at accuracy tier, ACC_*, until it goes
+// out of scope; astro_setaccuracy sets the default of all threads
+class AccuracyScope
+{
+public:
+    explicit AccuracyScope(int accuracy) : previous(astro_threadaccuracy(accuracy)) {}
+    ~AccuracyScope() { astro_threadaccuracy(previous); }
+
+private:
+    int previous;
+};
+
 namespace astro
 {
     class Date
@@ -9,6 +9,18 @@
 #include "astro_export.h"
 #include <stdio.h>
 
+/* storage class for the caches of last-computed values kept by many of the
+ * functions below. each thread keeps its own copy so independent
+ * computations may run concurrently without locking.
+ */
+#ifndef ASTRO_TLS
+#if defined(_MSC_VER)
+#define	ASTRO_TLS	__declspec(thread)
+#else
+#define	ASTRO_TLS	__thread
+#endif
+#endif
+
 #ifndef PI
 #define	PI		3.141592653589793
 #endif
@@ -104,6 +116,31 @@ typedef struct {
 #define tznm	np->n_tznm
 #define mjed	mm_mjed(np)
 
+/* values that depend only on the instant, shared by every object computed
+ * at that instant. fill with time_ctx() and pass to obj_cir_ctx().
+ */
+typedef struct {
+	double tc_mjd;		/* the n_mjd these are for */
+	double tc_mjed;		/* same, in TT */
+	double tc_eps;		/* mean obliquity of date, rads */
+	double tc_deps;		/* nutation in obliquity, rads */
+	double tc_dpsi;		/* nutation in longitude, rads */
+	double tc_lsn, tc_bsn;	/* sun's true geocentric ecliptic lng and lat */
+	double tc_rsn;		/* sun's distance, AU */
+	double tc_gast;		/* greenwich apparent sidereal time, hrs */
+	double tc_nut[3][3];	/* mean to true equator of date */
+	double tc_prec[3][3];	/* J2000 to mean equator of date */
+	int tc_acc;		/* the astro_accuracy() these are for */
+} TimeCtx;
+
+/* accuracy tiers, for astro_setaccuracy(). each trades precision for speed
+ * in the series behind every position; see circum.c for what each leaves
+ * out and the errors it brings.
+ */
+#define	ACC_FULL	0	/* complete series, every correction */
+#define	ACC_STANDARD	1	/* about an arc second */
+#define	ACC_DISPLAY	2	/* about an arc minute, for curves and searches */
+
 /* structures to describe objects of various types.
  */
 
@@ -328,11 +365,13 @@ typedef struct {
     float  eso_decay;	/* orbit decay rate, rev/day^2 */
     float  eso_drag;	/* object drag coefficient, (earth radii)^-1 */
     int    eso_orbit;	/* integer orbit number of epoch */
+    struct _SatProp *eso_prop; /* initialised sgp4/sdp4 state, see esat_init() */
 
     /* computed "sky" results unique to earth satellites */
     float  ess_elev;	/* height of satellite above sea level, m */
     float  ess_range;	/* line-of-site distance from observer to satellite, m*/
     float  ess_rangev;	/* rate-of-change of range, m/s */
+    float  ess_altv;	/* rate-of-change of refracted altitude, rads/s */
     float  ess_sublat;	/* latitude below satellite, >0 north, rads */
     float  ess_sublng;	/* longitude below satellite, >0 east, rads */
     int    ess_eclipsed;/* 1 if satellite is in earth's shadow, else 0 */
@@ -393,6 +432,7 @@ typedef union {
 #define	s_elev		es.ess_elev
 #define	s_range		es.ess_range
 #define	s_rangev	es.ess_rangev
+#define	s_altv		es.ess_altv
 #define	s_sublat	es.ess_sublat
 #define	s_sublng	es.ess_sublng
 #define	s_eclipsed	es.ess_eclipsed
@@ -459,6 +499,7 @@ typedef union {
 #define	es_decay	es.eso_decay
 #define	es_drag		es.eso_drag
 #define	es_orbit	es.eso_orbit
+#define	es_prop		es.eso_prop
 
 #define	pl_code		pl.plo_code
 #define	pl_moon		pl.plo_moon
@@ -584,6 +625,55 @@ enum _uramoons {
 
 #define	X_MAXNMOONS	S_NMOONS		/* N.B. chosen by hand */
 
+/* hot path instrumentation, see stats.c. the hooks cost nothing unless
+ * the library is built with ASTRO_STATS defined.
+ */
+enum _statcounts {
+    STAT_OBJ_CIR,				/* reductions, any Obj type */
+    STAT_OBJ_EARTHSAT,
+    STAT_VSOP87,
+    STAT_MOON,
+    STAT_NUTATION, STAT_NUTATION_HIT,		/* calls, answered by cache */
+    STAT_DELTAT, STAT_DELTAT_HIT,
+    STAT_PLANS, STAT_PLANS_HIT,			/* hit: sun at mj kept */
+    STAT_PRECESS, STAT_PRECESS_HIT,		/* hit: both epochs kept */
+    NSTATCOUNTS
+};
+
+enum _stattimers {
+    STAT_T_MODIFIED_RISET,			/* GetModifiedRisetS() */
+    STAT_T_ALTX_SUN,				/* FindAltXSun() */
+    STAT_T_MOON_PHASE,				/* FindMoonPhase() */
+    STAT_T_MOON_PHASE_EVENTS,			/* and FindMoonPhaseEvent() */
+    STAT_T_RADEC_RISET,
+    STAT_T_STAR_RISETS,
+    STAT_T_TRANSFORM_STARS,
+    STAT_T_SKY_POSITIONS,
+    STAT_T_SATELLITE_POSITION,
+    STAT_T_SATELLITE_STATUS,
+    STAT_T_SATELLITE_PASS,
+    STAT_T_SATELLITE_PASSES,
+    STAT_T_SUN_DETAILS,
+    STAT_T_WARM_CACHE,
+    STAT_T_ALMANAC,
+    STAT_T_SITE_POSITIONS,
+    STAT_T_SITE_RISETS,
+    NSTATTIMERS
+};
+
+#define	STAT_NBUCKETS	40	/* st_hist[t][i] counts [2^i, 2^(i+1)) ns */
+
+typedef struct {
+	unsigned long long st_count[NSTATCOUNTS];
+	unsigned long long st_hist[NSTATTIMERS][STAT_NBUCKETS];
+} AstroStats;
+
+#ifdef ASTRO_STATS
+#define	STAT_COUNT(s)	stats_count(s)
+#else
+#define	STAT_COUNT(s)	((void)0)
+#endif
+
 
 /* global function declarations */
 
@@ -616,13 +706,29 @@ ASTRO_EXPORT  char *msa_atlas (double ra, double dec);
 /* aux.c */
 ASTRO_EXPORT  double mm_mjed (Now *np);
 
+/* bdl.c */
+ASTRO_EXPORT  int bdl_moons (int pl, double jd[], int n, double *xp, double *yp,
+    double *zp);
+
 /* chap95.c */
 ASTRO_EXPORT  int chap95 (double m, int obj, double prec, double *ret);
 
 /* chap95_data.c */
 
+/* chebcache.c */
+ASTRO_EXPORT  int ephc_warm (PLCode p, double mj0, double mj1, double tol);
+ASTRO_EXPORT  void ephc_clear (void);
+ASTRO_EXPORT  void ephc_setmax (int n);
+ASTRO_EXPORT  int ephc_get (PLCode p, double mj, double *ret);
+ASTRO_EXPORT  int ephc_save (char *fn, double mj0, double mj1, double tol);
+ASTRO_EXPORT  int ephc_load (char *fn);
+
 /* circum.c */
 ASTRO_EXPORT  int obj_cir (Now *np, Obj *op);
+ASTRO_EXPORT  int obj_cir_ctx (Now *np, const TimeCtx *tc, Obj *op);
+ASTRO_EXPORT  int astro_setaccuracy (int acc);
+ASTRO_EXPORT  int astro_threadaccuracy (int acc);
+ASTRO_EXPORT  int astro_accuracy (void);
 
 /* comet.c */
 ASTRO_EXPORT  void comet (double m, double ep, double inc, double ap, double qp,
@@ -651,9 +757,12 @@ ASTRO_EXPORT  int dateRangeOK (Now *np, Obj *op);
 
 /* deltat.c */
 ASTRO_EXPORT  double deltat (double m);
+ASTRO_EXPORT  int deltat_load (char *fn);
 
 /* earthsat.c */
 ASTRO_EXPORT  int obj_earthsat (Now *np, Obj *op);
+ASTRO_EXPORT  int esat_init (Obj *op);
+ASTRO_EXPORT  void esat_free (Obj *op);
 
 /* eq_ecl.c */
 ASTRO_EXPORT  void eq_ecl (double m, double ra, double dec, double *lt,double *lg);
@@ -728,6 +837,8 @@ ASTRO_EXPORT  void radecrange (double *ra, double *dec);
 /* moon.c */
 ASTRO_EXPORT  void moon (double m, double *lam, double *bet, double *rho,
     double *msp, double *mdp);
+ASTRO_EXPORT  void moon_n (int n, const double *m, double *lam, double *bet,
+    double *rho, double *msp, double *mdp);
 
 /* mooncolong.c */
 ASTRO_EXPORT  void moon_colong (double jd, double lt, double lg, double *cp,
@@ -739,6 +850,8 @@ ASTRO_EXPORT  void moonnf (double mj, double *mjn, double *mjf);
 /* nutation.c */
 ASTRO_EXPORT  void nutation (double m, double *deps, double *dpsi);
 ASTRO_EXPORT  void nut_eq (double m, double *ra, double *dec);
+ASTRO_EXPORT  void nut_matrix (double eps, double deps, double dpsi,
+    double a[3][3]);
 
 /* obliq.c */
 ASTRO_EXPORT  void obliquity (double m, double *eps);
@@ -755,6 +868,7 @@ ASTRO_EXPORT  double parallacticLHD (double lt, double ha, double dec);
 ASTRO_EXPORT  void plans (double m, PLCode p, double *lpd0, double *psi0,
     double *rp0, double *rho0, double *lam, double *bet, double *dia,
     double *mag);
+ASTRO_EXPORT  void planpos (double mj, int obj, double prec, double *ret);
 
 /* plshadow.c */
 ASTRO_EXPORT  int plshadow (Obj *op, Obj *sop, double polera,
@@ -767,6 +881,7 @@ ASTRO_EXPORT  void setMoonDir (char *dir);
 
 /* precess.c */
 ASTRO_EXPORT  void precess (double mjd1, double mjd2, double *ra, double *dec);
+ASTRO_EXPORT  void precess_matrix (double mj, double m[3][3]);
 
 /* reduce.c */
 ASTRO_EXPORT  void reduce_elements (double mjd0, double m, double inc0,
@@ -800,9 +915,26 @@ ASTRO_EXPORT  void sphcart (double l, double b, double r, double *x, double *y,
 ASTRO_EXPORT  void cartsph (double x, double y, double z, double *l, double *b,
     double *r);
 
+/* stats.c */
+ASTRO_EXPORT  int stats_enabled (void);
+ASTRO_EXPORT  void stats_count (int s);
+ASTRO_EXPORT  unsigned long long stats_clock (void);
+ASTRO_EXPORT  void stats_time (int t, unsigned long long ns);
+ASTRO_EXPORT  void stats_snapshot (AstroStats *sp);
+ASTRO_EXPORT  void stats_reset (void);
+ASTRO_EXPORT  const char *stats_count_name (int s);
+ASTRO_EXPORT  const char *stats_timer_name (int t);
+
 /* sun.c */
 ASTRO_EXPORT  void sunpos (double m, double *lsn, double *rsn, double *bsn);
 
+/* timectx.c */
+ASTRO_EXPORT  void time_ctx (Now *np, TimeCtx *tc);
+ASTRO_EXPORT  void tc_nut_eq (const TimeCtx *tc, double *ra, double *dec);
+ASTRO_EXPORT  void tc_precess (const TimeCtx *tc, double mjd1, double mjd2,
+    double *ra, double *dec);
+ASTRO_EXPORT  void tc_lst (const TimeCtx *tc, Now *np, double *lstp);
+
 /* twobody.c */
 ASTRO_EXPORT  int vrc (double *v, double *r, double tp, double e, double q);
 
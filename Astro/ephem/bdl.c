@@ -1,13 +1,213 @@
 /* crack natural satellite files from BDL */
 
+#include <stdlib.h>
 #include <math.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #include "astro.h"
 #include "bdl.h"
 
+#define	BDL_KMAU	(1000./149597870.)	/* au per km */
+
 int read_bdl (FILE *fp, double jd, double *xp, double *yp, double *zp,
               char ynot[]) { return 0;}
 
+/* the 2040 sets end where their first moon's records run out, in January
+ * 2040; the moons' own theories take over after that.
+ */
+BDL_Span bdl_spans[] = {
+    {MARS,    2451179.5, 2455562.5, &mars_9910},	/* 1999 .. 2011 UTC */
+    {MARS,    2455562.5, 2459215.5, &mars_1020},	/* 2011 .. 2021 UTC */
+    {MARS,    2459215.5, 2466169.5, &mars_2040},	/* 2021 .. 2040 Jan 16 UTC */
+    {JUPITER, 2451179.5, 2455562.5, &jupiter_9910},
+    {JUPITER, 2455562.5, 2459215.5, &jupiter_1020},
+    {JUPITER, 2459215.5, 2466169.5, &jupiter_2040},
+    {SATURN,  2451179.5, 2455562.5, &saturne_9910},
+    {SATURN,  2455562.5, 2459215.5, &saturne_1020},
+    {SATURN,  2459215.5, 2466161.5, &saturne_2040},
+    {URANUS,  2451179.5, 2455562.5, &uranus_9910},
+    {URANUS,  2455562.5, 2459215.5, &uranus_1020},
+    {URANUS,  2459215.5, 2466188.5, &uranus_2040},
+};
+int bdl_nspans = sizeof(bdl_spans)/sizeof(bdl_spans[0]);
+
+/* expand record r into *tp */
+static void
+bdl_term (BDL_Record *r, BDL_Term *tp)
+{
+	double *cm[3], *cf[3];
+	int a, k;
+
+	cm[0] = r->cmx; cm[1] = r->cmy; cm[2] = r->cmz;
+	cf[0] = r->cfx; cf[1] = r->cfy; cf[2] = r->cfz;
+
+	tp->t1 = floor(r->t0) + 0.5;
+	for (a = 0; a < 3; a++) {
+	    tp->c[a][0] = cm[a][0];
+	    tp->c[a][1] = cm[a][1];
+	    for (k = 0; k < 4; k++) {
+		tp->c[a][2+2*k] = cm[a][2+k]*cos(cf[a][k]);
+		tp->c[a][3+2*k] = cm[a][2+k]*sin(cf[a][k]);
+	    }
+	}
+}
+
+/* give dataset its terms[], if it has none yet.
+ * N.B. not for datasets other threads may be reading at the same time.
+ * return 0 if ok, -1 if no memory.
+ */
+int
+bdl_flatten (BDL_Dataset *dataset)
+{
+	BDL_Term *terms;
+	unsigned i;
+
+	if (dataset->terms)
+	    return (0);
+	terms = (BDL_Term *) malloc (dataset->nrec * sizeof(BDL_Term));
+	if (!terms)
+	    return (-1);
+	for (i = 0; i < dataset->nrec; i++)
+	    bdl_term (&dataset->moonrecords[i], &terms[i]);
+	dataset->terms = terms;
+	return (0);
+}
+
+/* flatten every built-in dataset, once. they stay as they are if there is
+ * not the memory; do_bdl() copes.
+ */
+static void
+bdl_build (void)
+{
+	int i;
+
+	for (i = 0; i < bdl_nspans; i++)
+	    bdl_flatten (bdl_spans[i].dataset);
+}
+
+#ifdef _WIN32
+static INIT_ONCE bdl_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK
+bdl_once_cb (PINIT_ONCE once, PVOID param, PVOID *ctx)
+{
+	bdl_build();
+	return (TRUE);
+}
+
+static void
+bdl_init (void)
+{
+	InitOnceExecuteOnce (&bdl_once, bdl_once_cb, NULL, NULL);
+}
+#else
+static pthread_once_t bdl_once = PTHREAD_ONCE_INIT;
+
+static void
+bdl_init (void)
+{
+	pthread_once (&bdl_once, bdl_build);
+}
+#endif
+
+/* find the dataset describing the moons of planet pl at jd: from the
+ * ephemeris file loaded with ephc_load() if it covers jd, else built in.
+ * return NULL if there is none.
+ */
+BDL_Dataset *
+bdl_dataset (int pl, double jd)
+{
+	BDL_Dataset *dataset = ephc_bdl (pl, jd);
+	int i;
+
+	if (dataset)
+	    return (dataset);
+	bdl_init();
+	for (i = 0; i < bdl_nspans; i++)
+	    if (bdl_spans[i].pl == pl && jd >= bdl_spans[i].jd0
+						&& jd < bdl_spans[i].jd1)
+		return (bdl_spans[i].dataset);
+	return (NULL);
+}
+
+/* one past the last record of moon i of dataset */
+static int
+bdl_mend (BDL_Dataset *dataset, int i)
+{
+	if (dataset->mend)
+	    return ((int)dataset->mend[i]);
+	if (i+1 < (int)dataset->nsat)
+	    return ((int)dataset->idn[i+1] - 2);
+	return ((int)dataset->nrec);
+}
+
+/* do_bdl_n() with the dates of each moon stride apart in xp/yp/zp */
+static void
+bdl_eval (BDL_Dataset *dataset, double *jd, int n, int stride, double *xp,
+double *yp, double *zp)
+{
+	int nsat = dataset->nsat;
+	double djj = dataset->djj;
+	unsigned *idn = dataset->idn;
+	double *freq = dataset->freq;
+	double *delt = dataset->delt;
+	int i, k;
+
+	/* a moon at a time, so its few records stay in cache over the dates */
+	for (i = 0; i < nsat; i++) {
+	    double anu = freq[i];
+	    int lo = i > 0 ? bdl_mend (dataset, i-1) : 0;
+	    int hi = bdl_mend (dataset, i) - 1;
+
+	    for (k = 0; k < n; k++) {
+		int id = (int)floor((jd[k]-djj)/delt[i]) + (int)idn[i] - 2;
+		double tau, tau2, at, s1, c1, s2, c2, v[3];
+		BDL_Term term, *tp;
+		int a;
+
+		/* a moon's records may end a little before the dataset's span
+		 * does; stay with its own rather than read the next moon's.
+		 */
+		if (id < lo)
+		    id = lo;
+		else if (id > hi)
+		    id = hi;
+
+		if (dataset->terms)
+		    tp = &dataset->terms[id];
+		else {
+		    bdl_term (&dataset->moonrecords[id], &term);
+		    tp = &term;
+		}
+
+		tau = jd[k] - tp->t1;
+		tau2 = tau * tau;
+		at = tau*anu;
+		s1 = sin(at);
+		c1 = cos(at);
+		s2 = 2*s1*c1;
+		c2 = c1*c1 - s1*s1;
+
+		for (a = 0; a < 3; a++) {
+		    double *c = tp->c[a];
+		    v[a] = c[0] + c[1]*tau + c[2]*s1 + c[3]*c1
+				+ tau*(c[4]*s1 + c[5]*c1)
+				+ tau2*(c[6]*s1 + c[7]*c1)
+				+ c[8]*s2 + c[9]*c2;
+		}
+
+		xp[i*stride+k] = v[0]*BDL_KMAU;
+		yp[i*stride+k] = v[1]*BDL_KMAU;
+		zp[i*stride+k] = v[2]*BDL_KMAU;
+	    }
+	}
+}
+
 /* using a BDL planetary moon dataset defined in a struct in RAM and a
  * JD, find the x/y/z positions of each satellite. store in the given arrays,
  * assumed to have one entry per moon. values are planetocentric, +x east, +y
@@ -17,52 +217,39 @@ int read_bdl (FILE *fp, double jd, double *xp, double *yp, double *zp,
 void
 do_bdl (BDL_Dataset *dataset, double jd, double *xp, double *yp, double *zp)
 {
-        int nsat = dataset->nsat;
-        double djj = dataset->djj;
-        unsigned *idn = dataset->idn;
-        double *freq = dataset->freq;
-        double *delt = dataset->delt;
-	double t0;
-	int i;
+	do_bdl_n (dataset, &jd, 1, xp, yp, zp);
+}
 
-	/* compute location of each satellite */
-	for (i = 0; i < nsat; i++) {
-	    int id = (int)floor((jd-djj)/delt[i]) + idn[i] - 2;
-	    double t1, anu, tau, tau2, at;
-	    double tbx, tby, tbz;
-            double *cmx, *cfx, *cmy, *cfy, *cmz, *cfz;
-            BDL_Record *r = & dataset->moonrecords[id];
-
-            t0 = r->t0;
-	    t1 = floor(t0) + 0.5;
-	    anu = freq[i];
-	    tau = jd - t1;
-	    tau2 = tau * tau;
-	    at = tau*anu;
-
-            cmx = & (r->cmx[0]); /* point at data in appropriate record */
-            cfx = & (r->cfx[0]);
-            cmy = & (r->cmy[0]);
-            cfy = & (r->cfy[0]);
-            cmz = & (r->cmz[0]);
-            cfz = & (r->cfz[0]);
-
-	    tbx = cmx[0]+cmx[1]*tau+cmx[2]*sin(at+cfx[0])
-			    +cmx[3]*tau*sin(at+cfx[1])
-			    +cmx[4]*tau2*sin(at+cfx[2])
-			    +cmx[5]*sin(2*at+cfx[3]);
-	    tby = cmy[0]+cmy[1]*tau+cmy[2]*sin(at+cfy[0])
-			    +cmy[3]*tau*sin(at+cfy[1])
-			    +cmy[4]*tau2*sin(at+cfy[2])
-			    +cmy[5]*sin(2*at+cfy[3]);
-	    tbz = cmz[0]+cmz[1]*tau+cmz[2]*sin(at+cfz[0])
-			    +cmz[3]*tau*sin(at+cfz[1])
-			    +cmz[4]*tau2*sin(at+cfz[2])
-			    +cmz[5]*sin(2*at+cfz[3]);
-
-	    xp[i] = tbx*1000./149597870.;
-	    yp[i] = tby*1000./149597870.;
-	    zp[i] = tbz*1000./149597870.;
-	}
+/* same as do_bdl() for each of the n dates jd[], all within dataset.
+ * xp/yp/zp each get n entries per moon, all dates of the first moon first.
+ */
+void
+do_bdl_n (BDL_Dataset *dataset, double *jd, int n, double *xp, double *yp,
+double *zp)
+{
+	bdl_eval (dataset, jd, n, n, xp, yp, zp);
 }
 
+/* planetocentric x/y/z in au of the moons of planet pl, MARS through
+ * URANUS, at each of the n julian dates jd[], as do_bdl() but with each run of dates served by the
+ * same dataset evaluated in one pass; xp/yp/zp each get n entries per
+ * moon, all dates of the first moon first. return the number of moons, or
+ * -1 if pl has none at some date.
+ */
+int
+bdl_moons (int pl, double jd[], int n, double *xp, double *yp, double *zp)
+{
+	int k, k0, nsat = 0;
+
+	for (k0 = 0; k0 < n; k0 = k) {
+	    BDL_Dataset *dataset = bdl_dataset (pl, jd[k0]);
+
+	    if (!dataset || (k0 > 0 && (int)dataset->nsat != nsat))
+		return (-1);
+	    nsat = dataset->nsat;
+	    for (k = k0 + 1; k < n && bdl_dataset (pl, jd[k]) == dataset; k++)
+		continue;
+	    bdl_eval (dataset, jd + k0, k - k0, n, xp + k0, yp + k0, zp + k0);
+	}
+	return (nsat);
+}
@@ -8,6 +8,17 @@ typedef struct {
      double cmx[6], cfx[4], cmy[6], cfy[4], cmz[6], cfz[4]; /* coefficients */
 } BDL_Record;
 
+/* a BDL_Record with each periodic term a*sin(k*at + f) expanded into
+ * (a*cos f)*sin(k*at) + (a*sin f)*cos(k*at), so one sin and cos of the
+ * moon's angle at serve all the terms of the three axes.
+ */
+typedef struct {
+     double t1; /* floor(t0) + .5, where tau counts from */
+     double c[3][10]; /* x, y, z: cm[0], cm[1], then sin and cos weights of
+                       * cm[2], cm[3]*tau and cm[4]*tau^2 with at, and of
+                       * cm[5] with 2*at */
+} BDL_Term;
+
 typedef struct {
      unsigned nsat; /* number of satellites described in file */
      double djj; /* beginning Julian date of dataset*/
@@ -15,10 +26,30 @@ typedef struct {
      double *freq; /* frequency of moon records? */
      double *delt; /* time delta between successive moon records */
      BDL_Record *moonrecords;
+     unsigned nrec; /* number of moonrecords */
+     BDL_Term *terms; /* moonrecords as BDL_Terms, see bdl_flatten() */
+     unsigned *mend; /* one past the last record of each moon, or NULL
+                      * when each moon's records end where the next
+                      * moon's start at idn - 2, as in the built-in data */
 } BDL_Dataset;
 
 extern void do_bdl (BDL_Dataset *dataset, double jd,
                     double *xp, double *yp, double *zp);
+extern void do_bdl_n (BDL_Dataset *dataset, double *jd, int n,
+                    double *xp, double *yp, double *zp);
+extern int bdl_flatten (BDL_Dataset *dataset);
+extern BDL_Dataset *bdl_dataset (int pl, double jd);
+extern BDL_Dataset *ephc_bdl (int pl, double jd);
+
+/* which built-in dataset serves a planet's moons when */
+typedef struct {
+     int pl; /* MARS, JUPITER, SATURN or URANUS */
+     double jd0, jd1; /* dataset is used for jd0 <= jd < jd1 */
+     BDL_Dataset *dataset;
+} BDL_Span;
+
+extern BDL_Span bdl_spans[];
+extern int bdl_nspans;
 
 /* Data sets */
 
@@ -0,0 +1,826 @@
+/* piecewise Chebyshev approximations of the planet, earth and moon series.
+ *
+ * ephc_warm() samples the full theories over a span of time and stores
+ * equal-length segments of Chebyshev coefficients for one body; planpos(),
+ * sunpos() and moon() then answer from those segments in O(degree) time
+ * whenever the requested date is covered, and fall back to the series
+ * otherwise. nothing is cached until ephc_warm() is called, or a file
+ * written by ephc_save() is loaded with ephc_load().
+ *
+ * the tables are shared by all threads and only change in ephc_warm(),
+ * ephc_clear() and ephc_setmax(); lookups merely read them. so warm up
+ * first, then compute from as many threads as desired, but do not warm
+ * or clear while other threads are computing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "astro.h"
+#include "bdl.h"
+
+#define	EPHC_NCOEF	14		/* coefficients per coordinate */
+#define	EPHC_NCHECK	(2*EPHC_NCOEF)	/* error probes per segment */
+#define	EPHC_MAXCOMP	5		/* most coordinates of any body */
+#define	EPHC_DEFTOL	1e-8		/* default tolerance, rads */
+#define	EPHC_MINSPAN	(1./64)		/* give up below this segment, days */
+#define	EPHC_DEFMAX	32768		/* default bound on total segments */
+#define	EPHC_MAXSAT	16		/* most moons of a BDL data set */
+
+typedef struct {
+	double mj0;		/* start of first segment */
+	double span;		/* length of each segment, days */
+	int nseg;		/* number of segments */
+	int ncomp;		/* coordinates per sample */
+	long stamp;		/* warm-up order, for eviction */
+	int mapped;		/* coef points into the loaded file */
+	double *coef;		/* [nseg][ncomp][EPHC_NCOEF] */
+} EphcTable;
+
+static EphcTable *tables[NOBJ];	/* by PLCode, NULL if not warmed */
+static int maxsegs = EPHC_DEFMAX;
+static long nstamp;
+
+static void ephc_unload (void);
+
+/* initial segment lengths, days; halved until the tolerance is met */
+static double startspan[MOON+1] = {
+	/* Mercury */	16,
+	/* Venus */	32,
+	/* Mars */	64,
+	/* Jupiter */	128,
+	/* Saturn */	128,
+	/* Uranus */	128,
+	/* Neptune */	128,
+	/* Pluto */	128,
+	/* Sun */	32,
+	/* Moon */	4,
+};
+
+/* number of coordinates kept for body p: rectangular position, plus the
+ * sun's and moon's mean anomalies for the moon. the latter are only good
+ * modulo 2*PI.
+ */
+static int
+ephc_ncomp (int p)
+{
+	return (p == MOON ? 5 : 3);
+}
+
+/* evaluate the full theory for body p at the n dates mj[] into
+ * rectangular v[]. the moon's are done together by moon_n(), at ACC_FULL
+ * whatever this thread's tier.
+ * N.B. relies on the caller having removed p's table, so this does not
+ *   recurse into the cache.
+ */
+static void
+ephc_sample (int p, int n, const double *mj, double v[][EPHC_MAXCOMP])
+{
+	double ret[6];
+	int k;
+
+	if (p == MOON) {
+	    double lam[EPHC_NCHECK], bet[EPHC_NCHECK], rho[EPHC_NCHECK];
+	    double ms[EPHC_NCHECK], md[EPHC_NCHECK];
+	    int was = astro_threadaccuracy (ACC_FULL);
+	    moon_n (n, mj, lam, bet, rho, ms, md);
+	    astro_threadaccuracy (was);
+	    for (k = 0; k < n; k++) {
+		sphcart (lam[k], bet[k], rho[k], &v[k][0], &v[k][1], &v[k][2]);
+		v[k][3] = ms[k];
+		v[k][4] = md[k];
+	    }
+	} else {
+	    for (k = 0; k < n; k++) {
+		if (p == SUN)
+		    vsop87 (mj[k], SUN, 0.0, ret);
+		else
+		    planpos (mj[k], p, 0.0, ret);
+		sphcart (ret[0], ret[1], ret[2], &v[k][0], &v[k][1], &v[k][2]);
+	    }
+	}
+}
+
+/* Clenshaw recurrence for one coordinate, x in [-1,1] */
+static double
+ephc_clenshaw (const double *c, double x)
+{
+	double b0 = 0, b1 = 0, b2;
+	int k;
+
+	for (k = EPHC_NCOEF-1; k > 0; k--) {
+	    b2 = b1;
+	    b1 = b0;
+	    b0 = 2*x*b1 - b2 + c[k];
+	}
+	return (x*b0 - b1 + c[0]);
+}
+
+/* fit segment [a, a+span] of body p into coef[ncomp][EPHC_NCOEF].
+ * return 0 if every probe is within tol, else -1.
+ */
+static int
+ephc_fit (int p, double a, double span, double tol, double *coef)
+{
+	double f[EPHC_NCHECK][EPHC_MAXCOMP], mj[EPHC_NCHECK];
+	int ncomp = ephc_ncomp (p);
+	int i, j, k;
+
+	/* sample at the Chebyshev nodes. these run backwards in time, so the
+	 * mean anomalies may be unwrapped by keeping each within PI of the
+	 * one before.
+	 */
+	for (k = 0; k < EPHC_NCOEF; k++)
+	    mj[k] = a + (cos (PI*(k + 0.5)/EPHC_NCOEF) + 1)*span/2;
+	ephc_sample (p, EPHC_NCOEF, mj, f);
+	for (k = 1; k < EPHC_NCOEF; k++)
+	    for (i = 3; i < ncomp; i++)
+		f[k][i] -= 2*PI*floor ((f[k][i] - f[k-1][i])/(2*PI) + 0.5);
+
+	for (i = 0; i < ncomp; i++) {
+	    for (j = 0; j < EPHC_NCOEF; j++) {
+		double s = 0;
+		for (k = 0; k < EPHC_NCOEF; k++)
+		    s += f[k][i]*cos (PI*j*(k + 0.5)/EPHC_NCOEF);
+		coef[i*EPHC_NCOEF + j] = s*2/EPHC_NCOEF;
+	    }
+	    coef[i*EPHC_NCOEF] /= 2;
+	}
+
+	/* probe between the nodes against the full theory. position error
+	 * is taken relative to the distance, ie, as an angle.
+	 */
+	for (k = 0; k < EPHC_NCHECK; k++) {
+	    double x = -1 + (2*k + 1.)/EPHC_NCHECK;
+	    mj[k] = a + (x + 1)*span/2;
+	}
+	ephc_sample (p, EPHC_NCHECK, mj, f);
+	for (k = 0; k < EPHC_NCHECK; k++) {
+	    double x = -1 + (2*k + 1.)/EPHC_NCHECK;
+	    double *v = f[k], d2 = 0, r2 = 0;
+
+	    for (i = 0; i < 3; i++) {
+		double d = ephc_clenshaw (coef + i*EPHC_NCOEF, x) - v[i];
+		d2 += d*d;
+		r2 += v[i]*v[i];
+	    }
+	    if (d2 > tol*tol*r2)
+		return (-1);
+	    for (i = 3; i < ncomp; i++) {
+		double d = ephc_clenshaw (coef + i*EPHC_NCOEF, x) - v[i];
+		if (fabs (d - 2*PI*floor (d/(2*PI) + 0.5)) > tol)
+		    return (-1);
+	    }
+	}
+
+	return (0);
+}
+
+static int
+ephc_total (void)
+{
+	int p, n = 0;
+
+	for (p = 0; p < NOBJ; p++)
+	    if (tables[p] && !tables[p]->mapped)
+		n += tables[p]->nseg;
+	return (n);
+}
+
+static void
+ephc_drop (int p)
+{
+	if (tables[p]) {
+	    if (!tables[p]->mapped)
+		free ((void *)tables[p]->coef);
+	    free ((void *)tables[p]);
+	    tables[p] = NULL;
+	}
+}
+
+/* drop warmed tables, oldest first, until n more segments fit under
+ * maxsegs. tables from the loaded file cost no memory of ours and stay.
+ */
+static void
+ephc_room (int n)
+{
+	while (ephc_total() + n > maxsegs) {
+	    int p, oldest = -1;
+	    for (p = 0; p < NOBJ; p++)
+		if (tables[p] && !tables[p]->mapped && (oldest < 0 ||
+				    tables[p]->stamp < tables[oldest]->stamp))
+		    oldest = p;
+	    if (oldest < 0)
+		break;
+	    ephc_drop (oldest);
+	}
+}
+
+/* precompute the segments of body p, MERCURY..MOON, covering [mj0, mj1]
+ * so that positions stay within tol radians of the full theory. tol <= 0
+ * means the default of 1e-8. any previous table of p is replaced; tables
+ * of other bodies are dropped, oldest first, if the total would exceed the
+ * bound set by ephc_setmax().
+ * return 0 if ok, else -1 and p is left uncached.
+ */
+int
+ephc_warm (PLCode p, double mj0, double mj1, double tol)
+{
+	EphcTable *tp;
+	double span;
+	int ncomp, nseg, s;
+
+	if (p < MERCURY || p > MOON || !(mj1 > mj0))
+	    return (-1);
+	if (tol <= 0)
+	    tol = EPHC_DEFTOL;
+
+	/* N.B. must be gone before sampling, see ephc_sample() */
+	ephc_drop (p);
+
+	tp = (EphcTable *) malloc (sizeof(EphcTable));
+	if (!tp)
+	    return (-1);
+	ncomp = ephc_ncomp (p);
+
+	for (span = startspan[p]; ; span /= 2) {
+	    if (span < EPHC_MINSPAN) {
+		free ((void *)tp);
+		return (-1);
+	    }
+	    nseg = (int)ceil ((mj1 - mj0)/span);
+	    if (nseg > maxsegs) {
+		free ((void *)tp);
+		return (-1);
+	    }
+	    tp->coef = (double *) malloc (nseg*ncomp*EPHC_NCOEF*sizeof(double));
+	    if (!tp->coef) {
+		free ((void *)tp);
+		return (-1);
+	    }
+	    for (s = 0; s < nseg; s++)
+		if (ephc_fit (p, mj0 + s*span, span, tol,
+					tp->coef + s*ncomp*EPHC_NCOEF) < 0)
+		    break;
+	    if (s == nseg)
+		break;
+	    free ((void *)tp->coef);
+	}
+
+	ephc_room (nseg);
+
+	tp->mj0 = mj0;
+	tp->span = span;
+	tp->nseg = nseg;
+	tp->ncomp = ncomp;
+	tp->stamp = nstamp++;
+	tp->mapped = 0;
+	tables[p] = tp;
+	return (0);
+}
+
+/* forget all precomputed segments, and any loaded file */
+void
+ephc_clear (void)
+{
+	int p;
+
+	for (p = 0; p < NOBJ; p++)
+	    ephc_drop (p);
+	ephc_unload ();
+}
+
+/* set the bound on the total number of segments held for all bodies,
+ * dropping tables, oldest first, to honor it at once.
+ */
+void
+ephc_setmax (int n)
+{
+	maxsegs = n;
+	ephc_room (0);
+}
+
+/* if body p is cached at mj, fill ret[] the way the series it stands for
+ * would and return 0, else return -1:
+ *   planets and SUN (earth): heliocentric l, b, r as from planpos()/vsop87();
+ *   MOON: geocentric lam, bet, rho, sun's and moon's mean anomaly as from
+ *   moon().
+ */
+int
+ephc_get (PLCode p, double mj, double *ret)
+{
+	EphcTable *tp;
+	const double *c;
+	double x, v[EPHC_MAXCOMP];
+	int s, i;
+
+	if (p < MERCURY || p > MOON || !(tp = tables[p]))
+	    return (-1);
+
+	x = (mj - tp->mj0)/tp->span;
+	if (!(x >= 0 && x <= tp->nseg))
+	    return (-1);
+	s = (int)x;
+	if (s == tp->nseg)
+	    s--;
+	x = 2*(x - s) - 1;
+
+	c = tp->coef + s*tp->ncomp*EPHC_NCOEF;
+	for (i = 0; i < tp->ncomp; i++)
+	    v[i] = ephc_clenshaw (c + i*EPHC_NCOEF, x);
+
+	cartsph (v[0], v[1], v[2], &ret[0], &ret[1], &ret[2]);
+	for (i = 3; i < tp->ncomp; i++)
+	    ret[i] = v[i];
+	return (0);
+}
+
+/* ephemeris file.
+ *
+ * ephc_save() writes the tables of all bodies fitted over a range of dates,
+ * together with the BDL records of the planetary moons for the same range.
+ * ephc_load() maps such a file read-only and serves planpos(), sunpos(),
+ * moon() and, via bdl_dataset(), the moon routines from it, so processes
+ * using the same file share one copy of it in the page cache.
+ *
+ * layout, native byte order, each part starting 8-byte aligned:
+ *   EphcHeader
+ *   EphcSect[nsect]
+ *   EPHC_CHEB data:	double coef[count][n][ncoef]
+ *   EPHC_BDL data:	unsigned idn[n] (padded), double freq[n], delt[n],
+ *			BDL_Record rec[count]
+ */
+
+#define	EPHC_MAGIC	"XEPHCHEB"
+#define	EPHC_VERSION	1
+#define	EPHC_ORDER	0x01020304	/* reads differently if swapped */
+#define	EPHC_CHEB	1
+#define	EPHC_BDL	2
+#define	EPHC_ALIGN(n)	(((n) + 7) & ~(size_t)7)
+
+typedef struct {
+	char magic[8];		/* EPHC_MAGIC, not 0-terminated */
+	unsigned int version;	/* EPHC_VERSION */
+	unsigned int order;	/* EPHC_ORDER */
+	unsigned int nsect;	/* EphcSect that follow */
+	unsigned int ncoef;	/* coefficients per coordinate, EPHC_NCOEF */
+	double mj0, mj1;	/* dates covered */
+	double tol;		/* tolerance the bodies were fitted to, rads */
+} EphcHeader;
+
+typedef struct {
+	unsigned int kind;	/* EPHC_CHEB or EPHC_BDL */
+	unsigned int code;	/* PLCode of the body, or planet of the moons */
+	unsigned int n;		/* CHEB: coordinates; BDL: satellites */
+	unsigned int count;	/* CHEB: segments; BDL: records */
+	double t0;		/* CHEB: mj of first segment; BDL: djj */
+	double t1;		/* CHEB: segment length; BDL: first jd served */
+	double t2;		/* BDL: jd served up to, exclusive */
+	unsigned int offset;	/* data, from start of file */
+	unsigned int size;	/* data, bytes */
+} EphcSect;
+
+typedef struct {
+	int pl;			/* planet whose moons these are */
+	double jd0, jd1;	/* served for jd0 <= jd < jd1 */
+	BDL_Dataset dataset;	/* arrays point into the file */
+	unsigned mend[EPHC_MAXSAT];	/* dataset.mend */
+} EphcBDL;
+
+static char *fbase;		/* loaded file, NULL if none */
+static size_t flen;
+static int fmapped;		/* fbase from mmap(), else malloc() */
+static EphcBDL *fbdl;		/* moon data sets in the file */
+static int nfbdl;
+
+/* records of one built-in BDL dataset kept in a file */
+typedef struct {
+	int span;			/* index into bdl_spans[] */
+	unsigned lo[EPHC_MAXSAT];	/* first record kept of each moon */
+	unsigned n[EPHC_MAXSAT];	/* records kept of each moon */
+} EphcClip;
+
+/* find the records of dataset ds needed to serve [jd0, jd1) into *cp and
+ * describe them in *sp, clipping jd1 to where the records of every moon
+ * end. return 0 if ok, -1 if nothing is left to serve.
+ */
+static int
+ephc_clip (BDL_Dataset *ds, double jd0, double jd1, EphcClip *cp,
+EphcSect *sp)
+{
+	unsigned i, nrec = 0;
+
+	if (ds->nsat > EPHC_MAXSAT)
+	    return (-1);
+	for (i = 0; i < ds->nsat; i++) {
+	    unsigned end = i+1 < ds->nsat ? ds->idn[i+1] - 2 : ds->nrec;
+	    double jdend = ds->djj + (end - (ds->idn[i] - 2))*ds->delt[i];
+	    if (jd1 > jdend)
+		jd1 = jdend;
+	}
+	if (!(jd1 > jd0))
+	    return (-1);
+
+	for (i = 0; i < ds->nsat; i++) {
+	    unsigned end = i+1 < ds->nsat ? ds->idn[i+1] - 2 : ds->nrec;
+	    unsigned a = ds->idn[i] - 2
+				+ (unsigned)floor((jd0 - ds->djj)/ds->delt[i]);
+	    unsigned b = ds->idn[i] - 2
+				+ (unsigned)floor((jd1 - ds->djj)/ds->delt[i]);
+	    if (b >= end)
+		b = end - 1;
+	    cp->lo[i] = a;
+	    cp->n[i] = b - a + 1;
+	    nrec += cp->n[i];
+	}
+
+	sp->kind = EPHC_BDL;
+	sp->n = ds->nsat;
+	sp->count = nrec;
+	sp->t0 = ds->djj;
+	sp->t1 = jd0;
+	sp->t2 = jd1;
+	sp->size = EPHC_ALIGN(ds->nsat*sizeof(unsigned))
+			+ 2*ds->nsat*sizeof(double) + nrec*sizeof(BDL_Record);
+	return (0);
+}
+
+/* write the kept records of dataset ds, renumbered so do_bdl() finds
+ * them in the subset with the same djj. N.B. that makes the idn of a moon
+ * negative when its records before jd0 are dropped; do_bdl() does the
+ * arithmetic signed.
+ */
+static int
+ephc_writebdl (FILE *fp, BDL_Dataset *ds, EphcClip *cp)
+{
+	static char zero[8];
+	unsigned idn[EPHC_MAXSAT];
+	size_t pad = EPHC_ALIGN(ds->nsat*sizeof(unsigned))
+						- ds->nsat*sizeof(unsigned);
+	unsigned i, base = 0;
+
+	for (i = 0; i < ds->nsat; i++) {
+	    idn[i] = ds->idn[i] - cp->lo[i] + base;
+	    base += cp->n[i];
+	}
+
+	if (fwrite (idn, sizeof(unsigned), ds->nsat, fp) != ds->nsat
+		|| fwrite (zero, 1, pad, fp) != pad
+		|| fwrite (ds->freq, sizeof(double), ds->nsat, fp) != ds->nsat
+		|| fwrite (ds->delt, sizeof(double), ds->nsat, fp) != ds->nsat)
+	    return (-1);
+	for (i = 0; i < ds->nsat; i++)
+	    if (fwrite (&ds->moonrecords[cp->lo[i]], sizeof(BDL_Record),
+						cp->n[i], fp) != cp->n[i])
+		return (-1);
+	return (0);
+}
+
+/* fit all bodies, MERCURY..MOON, over [mj0, mj1] to tol (<= 0 for the
+ * default) and write them, with the BDL moon records of the same dates,
+ * to the ephemeris file fn. the bodies stay warmed afterwards.
+ * return 0 if ok, else -1.
+ */
+int
+ephc_save (char *fn, double mj0, double mj1, double tol)
+{
+	static char zero[8];
+	EphcHeader h;
+	EphcSect *sect;
+	EphcClip *clip;
+	size_t off;
+	FILE *fp;
+	int nsect = 0, nclip = 0;
+	int p, i, ok;
+
+	if (tol <= 0)
+	    tol = EPHC_DEFTOL;
+	for (p = MERCURY; p <= MOON; p++)
+	    if (ephc_warm (p, mj0, mj1, tol) < 0)
+		return (-1);
+	for (p = MERCURY; p <= MOON; p++)
+	    if (!tables[p])
+		return (-1);	/* evicted, see ephc_setmax() */
+
+	sect = (EphcSect *) calloc (MOON+1 + bdl_nspans, sizeof(EphcSect));
+	clip = (EphcClip *) calloc (bdl_nspans, sizeof(EphcClip));
+	if (!sect || !clip) {
+	    free ((void *)sect);
+	    free ((void *)clip);
+	    return (-1);
+	}
+
+	/* index */
+	for (p = MERCURY; p <= MOON; p++) {
+	    EphcSect *sp = &sect[nsect++];
+	    sp->kind = EPHC_CHEB;
+	    sp->code = p;
+	    sp->n = tables[p]->ncomp;
+	    sp->count = tables[p]->nseg;
+	    sp->t0 = tables[p]->mj0;
+	    sp->t1 = tables[p]->span;
+	    sp->size = sp->count*sp->n*EPHC_NCOEF*sizeof(double);
+	}
+	for (i = 0; i < bdl_nspans; i++) {
+	    BDL_Span *bp = &bdl_spans[i];
+	    double jd0 = bp->jd0 > mj0 + MJD0 ? bp->jd0 : mj0 + MJD0;
+	    double jd1 = bp->jd1 < mj1 + MJD0 ? bp->jd1 : mj1 + MJD0;
+	    if (ephc_clip (bp->dataset, jd0, jd1, &clip[nclip],
+							&sect[nsect]) < 0)
+		continue;
+	    clip[nclip++].span = i;
+	    sect[nsect++].code = bp->pl;
+	}
+	off = sizeof(h) + nsect*sizeof(EphcSect);
+	for (i = 0; i < nsect; i++) {
+	    off = EPHC_ALIGN(off);
+	    sect[i].offset = (unsigned)off;
+	    off += sect[i].size;
+	}
+
+	memset (&h, 0, sizeof(h));
+	memcpy (h.magic, EPHC_MAGIC, sizeof(h.magic));
+	h.version = EPHC_VERSION;
+	h.order = EPHC_ORDER;
+	h.nsect = nsect;
+	h.ncoef = EPHC_NCOEF;
+	h.mj0 = mj0;
+	h.mj1 = mj1;
+	h.tol = tol;
+
+	fp = fopen (fn, "wb");
+	ok = fp && fwrite (&h, sizeof(h), 1, fp) == 1
+		&& fwrite (sect, sizeof(EphcSect), nsect, fp) == (size_t)nsect;
+
+	/* data, in index order */
+	off = sizeof(h) + nsect*sizeof(EphcSect);
+	for (i = 0, nclip = 0; ok && i < nsect; i++) {
+	    EphcSect *sp = &sect[i];
+	    ok = fwrite (zero, 1, sp->offset - off, fp) == sp->offset - off;
+	    if (ok && sp->kind == EPHC_CHEB) {
+		size_t n = sp->count*sp->n*EPHC_NCOEF;
+		ok = fwrite (tables[sp->code]->coef, sizeof(double), n, fp) == n;
+	    } else if (ok) {
+		EphcClip *cp = &clip[nclip++];
+		ok = ephc_writebdl (fp, bdl_spans[cp->span].dataset, cp) == 0;
+	    }
+	    off = sp->offset + sp->size;
+	}
+	if (fp && fclose (fp) != 0)
+	    ok = 0;
+
+	free ((void *)sect);
+	free ((void *)clip);
+	return (ok ? 0 : -1);
+}
+
+/* the record of moon j of BDL section sp that serves its first jd, t1.
+ * idn is signed, see ephc_writebdl(). done in double so a bad file can
+ * not overflow it; ephc_check() makes sure it is a record of the section
+ * before ephc_load() uses it.
+ */
+static double
+ephc_bdlid (EphcSect *sp, unsigned *idn, double *delt, unsigned j)
+{
+	return (floor((sp->t1 - sp->t0)/delt[j]) + (int)idn[j] - 2.);
+}
+
+/* check the file of len bytes at base is one ephc_save() would write.
+ * return the number of sections if so, else -1.
+ */
+static int
+ephc_check (char *base, size_t len)
+{
+	EphcHeader *hp = (EphcHeader *)base;
+	EphcSect *sect = (EphcSect *)(base + sizeof(EphcHeader));
+	unsigned i, j;
+
+	if (len < sizeof(EphcHeader)
+		|| memcmp (hp->magic, EPHC_MAGIC, sizeof(hp->magic))
+		|| hp->version != EPHC_VERSION || hp->order != EPHC_ORDER
+		|| hp->ncoef != EPHC_NCOEF
+		|| hp->nsect > (len - sizeof(EphcHeader))/sizeof(EphcSect))
+	    return (-1);
+
+	/* sizes are worked out in size_t, each count first bounded by what
+	 * len could hold so the products can not wrap.
+	 */
+	for (i = 0; i < hp->nsect; i++) {
+	    EphcSect *sp = &sect[i];
+	    if (sp->offset % 8 || sp->offset > len || sp->size > len - sp->offset)
+		return (-1);
+	    if (sp->kind == EPHC_CHEB) {
+		size_t seg;
+		if (sp->code > MOON || sp->n < 1
+			|| sp->n != (unsigned)ephc_ncomp (sp->code))
+		    return (-1);
+		seg = (size_t)sp->n*EPHC_NCOEF*sizeof(double);
+		if (sp->count < 1 || sp->count > len/seg
+			|| sp->count > 0x7fffffff/(sp->n*EPHC_NCOEF)
+			|| sp->size != sp->count*seg
+			|| !(sp->t1 > 0))
+		    return (-1);
+	    } else if (sp->kind == EPHC_BDL) {
+		unsigned *idn = (unsigned *)(base + sp->offset);
+		double *delt = (double *)(base + sp->offset
+			    + EPHC_ALIGN(sp->n*sizeof(unsigned))) + sp->n;
+		double prev = -1;
+		if (sp->code < MARS || sp->code > URANUS
+			|| sp->n < 1 || sp->n > EPHC_MAXSAT
+			|| sp->count < 1 || sp->count > len/sizeof(BDL_Record)
+			|| sp->size != EPHC_ALIGN(sp->n*sizeof(unsigned))
+				    + 2*sp->n*sizeof(double)
+				    + (size_t)sp->count*sizeof(BDL_Record))
+		    return (-1);
+
+		/* each moon's first record lies past the one before's, so
+		 * every moon has records of its own from there to the next
+		 * moon's, the last to count; see ephc_load().
+		 */
+		for (j = 0; j < sp->n; j++) {
+		    double id;
+		    if (!(delt[j] > 0))
+			return (-1);
+		    id = ephc_bdlid (sp, idn, delt, j);
+		    if (!(id > prev && id < sp->count))
+			return (-1);
+		    prev = id;
+		}
+	    } else
+		return (-1);
+	}
+
+	return (hp->nsect);
+}
+
+/* read-only map the ephemeris file fn, as written by ephc_save(), and
+ * serve from it. anything cached or loaded before is forgotten first.
+ * return 0 if ok, else -1 with nothing loaded.
+ */
+int
+ephc_load (char *fn)
+{
+	EphcSect *sect;
+	struct stat st;
+	char *base;
+	size_t len;
+	int fd, nsect, i;
+	unsigned j;
+
+	ephc_clear ();
+
+#ifndef O_BINARY
+#define	O_BINARY	0
+#endif
+	fd = open (fn, O_RDONLY | O_BINARY);
+	if (fd < 0)
+	    return (-1);
+	if (fstat (fd, &st) < 0 || st.st_size <= 0) {
+	    close (fd);
+	    return (-1);
+	}
+	len = (size_t)st.st_size;
+
+#ifdef _WIN32
+	base = (char *) malloc (len);
+	if (base) {
+	    size_t got = 0;
+	    int n;
+	    while (got < len && (n = read (fd, base + got,
+						    (unsigned)(len - got))) > 0)
+		got += n;
+	    if (got < len) {
+		free ((void *)base);
+		base = NULL;
+	    }
+	}
+	fmapped = 0;
+#else
+	base = (char *) mmap (NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	if (base == (char *)MAP_FAILED)
+	    base = NULL;
+	fmapped = 1;
+#endif
+	close (fd);
+	if (!base)
+	    return (-1);
+	fbase = base;
+	flen = len;
+
+	nsect = ephc_check (base, len);
+	if (nsect < 0) {
+	    ephc_unload ();
+	    return (-1);
+	}
+	sect = (EphcSect *)(base + sizeof(EphcHeader));
+
+	fbdl = (EphcBDL *) calloc (nsect, sizeof(EphcBDL));
+	if (!fbdl) {
+	    ephc_unload ();
+	    return (-1);
+	}
+
+	for (i = 0; i < nsect; i++) {
+	    EphcSect *sp = &sect[i];
+	    char *data = base + sp->offset;
+
+	    if (sp->kind == EPHC_CHEB) {
+		EphcTable *tp = (EphcTable *) malloc (sizeof(EphcTable));
+		if (!tp) {
+		    ephc_clear ();
+		    return (-1);
+		}
+		ephc_drop (sp->code);
+		tp->mj0 = sp->t0;
+		tp->span = sp->t1;
+		tp->nseg = sp->count;
+		tp->ncomp = sp->n;
+		tp->stamp = nstamp++;
+		tp->mapped = 1;
+		tp->coef = (double *)data;
+		tables[sp->code] = tp;
+	    } else {
+		EphcBDL *bp = &fbdl[nfbdl++];
+		bp->pl = sp->code;
+		bp->jd0 = sp->t1;
+		bp->jd1 = sp->t2;
+		bp->dataset.nsat = sp->n;
+		bp->dataset.djj = sp->t0;
+		bp->dataset.idn = (unsigned *)data;
+		bp->dataset.freq = (double *)(data
+				    + EPHC_ALIGN(sp->n*sizeof(unsigned)));
+		bp->dataset.delt = bp->dataset.freq + sp->n;
+		bp->dataset.moonrecords = (BDL_Record *)(bp->dataset.delt
+								    + sp->n);
+		bp->dataset.nrec = sp->count;
+
+		/* each moon's kept records end where the next one's record
+		 * for jd0 is, the last moon's at the end
+		 */
+		for (j = 0; j < sp->n; j++)
+		    bp->mend[j] = j+1 < sp->n
+			    ? (unsigned)ephc_bdlid (sp, bp->dataset.idn,
+						    bp->dataset.delt, j+1)
+			    : sp->count;
+		bp->dataset.mend = bp->mend;
+		bdl_flatten (&bp->dataset);	/* else do_bdl() expands as it goes */
+	    }
+	}
+
+	return (0);
+}
+
+/* forget the loaded file, if any */
+static void
+ephc_unload (void)
+{
+	int p;
+
+	for (p = 0; p < NOBJ; p++)
+	    if (tables[p] && tables[p]->mapped)
+		ephc_drop (p);
+	for (p = 0; p < nfbdl; p++)
+	    free ((void *)fbdl[p].dataset.terms);
+	free ((void *)fbdl);
+	fbdl = NULL;
+	nfbdl = 0;
+
+	if (fbase) {
+#ifdef _WIN32
+	    free ((void *)fbase);
+#else
+	    if (fmapped)
+		munmap ((void *)fbase, flen);
+	    else
+		free ((void *)fbase);
+#endif
+	    fbase = NULL;
+	    flen = 0;
+	}
+}
+
+/* the moons of planet pl at jd from the loaded file, or NULL if it has
+ * none for that date.
+ */
+BDL_Dataset *
+ephc_bdl (int pl, double jd)
+{
+	int i;
+
+	for (i = 0; i < nfbdl; i++)
+	    if (fbdl[i].pl == pl && jd >= fbdl[i].jd0 && jd < fbdl[i].jd1)
+		return (&fbdl[i].dataset);
+	return (NULL);
+}
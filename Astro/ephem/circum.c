@@ -11,25 +11,31 @@
 #include <math.h>
 #include <stdlib.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 #include "astro.h"
 #include "preferences.h"
 
 
-static int obj_planet (Now *np, Obj *op);
-static int obj_binary (Now *np, Obj *op);
+static int obj_planet (Now *np, const TimeCtx *tc, Obj *op);
+static int obj_binary (Now *np, const TimeCtx *tc, Obj *op);
 static int obj_2binary (Now *np, Obj *op);
-static int obj_fixed (Now *np, Obj *op);
-static int obj_elliptical (Now *np, Obj *op);
-static int obj_hyperbolic (Now *np, Obj *op);
-static int obj_parabolic (Now *np, Obj *op);
-static int sun_cir (Now *np, Obj *op);
-static int moon_cir (Now *np, Obj *op);
+static int obj_fixed (Now *np, const TimeCtx *tc, Obj *op);
+static int obj_elliptical (Now *np, const TimeCtx *tc, Obj *op);
+static int obj_hyperbolic (Now *np, const TimeCtx *tc, Obj *op);
+static int obj_parabolic (Now *np, const TimeCtx *tc, Obj *op);
+static int sun_cir (Now *np, const TimeCtx *tc, Obj *op);
+static int moon_cir (Now *np, const TimeCtx *tc, Obj *op);
 static double solveKepler (double M, double e);
 static void binaryStarOrbit (double t, double T, double e, double o, double O,
     double i, double a, double P, double *thetap, double *rhop);
-static void cir_sky (Now *np, double lpd, double psi, double rp, double *rho,
-    double lam, double bet, double lsn, double rsn, Obj *op);
-static void cir_pos (Now *np, double bet, double lam, double *rho, Obj *op);
+static void cir_sky (Now *np, const TimeCtx *tc, double lpd, double psi,
+    double rp, double *rho, double lam, double bet, double lsn, double rsn,
+    Obj *op);
+static void cir_pos (Now *np, const TimeCtx *tc, double bet, double lam,
+    double *rho, Obj *op);
 static void elongation (double lam, double bet, double lsn, double *el);
 static void deflect (double mjd1, double lpd, double psi, double rsn,
     double lsn, double rho, double *ra, double *dec);
@@ -41,15 +47,38 @@ static double h_albsize (double H);
 int
 obj_cir (Now *np, Obj *op)
 {
+	static ASTRO_TLS TimeCtx tc = { .tc_mjd = -10000 };
+
+	/* earth satellites use none of the shared quantities */
+	if (op->o_type == EARTHSAT) {
+	    STAT_COUNT (STAT_OBJ_CIR);
+	    op->o_flags &= ~NOCIRCUM;
+	    return (obj_earthsat (np, op));
+	}
+
+	if (tc.tc_mjd != mjd || tc.tc_mjed != mjed
+					|| tc.tc_acc != astro_accuracy())
+	    time_ctx (np, &tc);
+	return (obj_cir_ctx (np, &tc, op));
+}
+
+/* same as obj_cir() but with the quantities that depend only on the instant
+ * already found by time_ctx(np, tc). saves redoing them when many objects are
+ * computed at the same np.
+ */
+int
+obj_cir_ctx (Now *np, const TimeCtx *tc, Obj *op)
+{
+	STAT_COUNT (STAT_OBJ_CIR);
 	op->o_flags &= ~NOCIRCUM;
 	switch (op->o_type) {
-	case BINARYSTAR: return (obj_binary (np, op));
-	case FIXED:	 return (obj_fixed (np, op));
-	case ELLIPTICAL: return (obj_elliptical (np, op));
-	case HYPERBOLIC: return (obj_hyperbolic (np, op));
-	case PARABOLIC:  return (obj_parabolic (np, op));
+	case BINARYSTAR: return (obj_binary (np, tc, op));
+	case FIXED:	 return (obj_fixed (np, tc, op));
+	case ELLIPTICAL: return (obj_elliptical (np, tc, op));
+	case HYPERBOLIC: return (obj_hyperbolic (np, tc, op));
+	case PARABOLIC:  return (obj_parabolic (np, tc, op));
 	case EARTHSAT:   return (obj_earthsat (np, op));
-	case PLANET:     return (obj_planet (np, op));
+	case PLANET:     return (obj_planet (np, tc, op));
 	default:
 	    printf ("obj_cir() called with type %d %s\n", op->o_type, op->o_name);
 	    abort();
@@ -57,8 +86,70 @@ obj_cir (Now *np, Obj *op)
 	}
 }
 
+/* the accuracy tier, for the process and, overriding it, for this thread */
+static long accuracy = ACC_FULL;
+static ASTRO_TLS int thread_accuracy = -1;
+
+/* accuracy may be set while other threads read it */
+#ifdef _WIN32
+#define	ACC_GET()	InterlockedCompareExchange (&accuracy, 0, 0)
+#define	ACC_SET(a)	InterlockedExchange (&accuracy, (a))
+#else
+#define	ACC_GET()	__atomic_load_n (&accuracy, __ATOMIC_RELAXED)
+#define	ACC_SET(a)	__atomic_exchange_n (&accuracy, (a), __ATOMIC_RELAXED)
+#endif
+
+/* set the accuracy tier, ACC_*, of every thread not set on its own with
+ * astro_threadaccuracy(). set it before computing from other threads.
+ * return the tier it was.
+ *
+ * the tiers cut the series at these thresholds, and the worst differences
+ * from ACC_FULL in apparent geocentric place found over 1900 .. 2100 are:
+ *
+ *   tier          vsop87, chap95  nutation terms  moon         deflection
+ *   ACC_FULL      complete        all             Moshier      yes
+ *   ACC_STANDARD  1e-6 rad        over .001"      Moshier      yes
+ *   ACC_DISPLAY   1e-4 rad        over .01"       moon_fast()  no
+ *
+ *   ACC_STANDARD: planets and sun .2", moon and stars .01"
+ *   ACC_DISPLAY:  planets and sun 20", moon 21", stars .05", or up to 1.9"
+ *		   within 10 degrees of the sun
+ *
+ * they take about 2/3 and 1/3 of the time of ACC_FULL.
+ *
+ * ephemeris files and cache tables are always made at ACC_FULL, and while
+ * they cover a time planets and the moon come from them at every tier.
+ */
+int
+astro_setaccuracy (int acc)
+{
+	if (acc >= ACC_FULL && acc <= ACC_DISPLAY)
+	    return ((int)ACC_SET (acc));
+	return ((int)ACC_GET());
+}
+
+/* set this thread's accuracy tier, or with -1 go back to the process's.
+ * return the one it had, -1 if it had none of its own.
+ */
+int
+astro_threadaccuracy (int acc)
+{
+	int was = thread_accuracy;
+
+	if (acc >= -1 && acc <= ACC_DISPLAY)
+	    thread_accuracy = acc;
+	return (was);
+}
+
+/* the accuracy tier in effect in this thread */
+int
+astro_accuracy (void)
+{
+	return (thread_accuracy >= 0 ? thread_accuracy : (int)ACC_GET());
+}
+
 static int
-obj_planet (Now *np, Obj *op)
+obj_planet (Now *np, const TimeCtx *tc, Obj *op)
 {
 	double lsn, rsn;	/* true geoc lng of sun; dist from sn to earth*/
 	double lpd, psi;	/* heliocentric ecliptic long and lat */
@@ -71,9 +162,9 @@ obj_planet (Now *np, Obj *op)
 	/* validate code and check for a few special cases */
 	p = op->pl_code;
 	if (p == SUN)
-	    return (sun_cir (np, op));
+	    return (sun_cir (np, tc, op));
 	if (p == MOON)
-	    return (moon_cir (np, op));
+	    return (moon_cir (np, tc, op));
 	if (op->pl_moon != X_PLANET)
 	    return (plmoon_cir (np, op));
 	if (p < 0 || p > MOON) {
@@ -84,15 +175,16 @@ obj_planet (Now *np, Obj *op)
 	/* planet itself */
 
 	/* find solar ecliptical longitude and distance to sun from earth */
-	sunpos (mjed, &lsn, &rsn, 0);
+	lsn = tc->tc_lsn;
+	rsn = tc->tc_rsn;
 
 	/* find helio long/lat; sun/planet and earth/planet dist; ecliptic
 	 * long/lat; diameter and mag.
 	 */
-	plans(mjed, p, &lpd, &psi, &rp, &rho, &lam, &bet, &dia, &mag);
+	plans(tc->tc_mjed, p, &lpd, &psi, &rp, &rho, &lam, &bet, &dia, &mag);
 
 	/* fill in all of op->s_* stuff except s_size and s_mag */
-	cir_sky (np, lpd, psi, rp, &rho, lam, bet, lsn, rsn, op);
+	cir_sky (np, tc, lpd, psi, rp, &rho, lam, bet, lsn, rsn, op);
 
 	/* set magnitude and angular size */
 	set_smag (op, mag);
@@ -102,10 +194,10 @@ obj_planet (Now *np, Obj *op)
 }
 
 static int
-obj_binary (Now *np, Obj *op)
+obj_binary (Now *np, const TimeCtx *tc, Obj *op)
 {
 	/* always compute circumstances of primary */
-	if (obj_fixed (np, op) < 0)
+	if (obj_fixed (np, tc, op) < 0)
 	    return (0);
 
 	/* compute secondary only if requested, and always reset request flag */
@@ -206,7 +298,7 @@ solveKepler (double M, double e)
 }
 
 static int
-obj_fixed (Now *np, Obj *op)
+obj_fixed (Now *np, const TimeCtx *tc, Obj *op)
 {
 	double lsn, rsn;	/* true geoc lng of sun, dist from sn to earth*/
 	double lam, bet;	/* geocentric ecliptic long and lat */
@@ -246,8 +338,8 @@ obj_fixed (Now *np, Obj *op)
 	/* set ra/dec to astrometric @ equinox of date */
 	ra = rpm;
 	dec = dpm;
-	if (op->f_epoch != mjed)
-	    precess (op->f_epoch, mjed, &ra, &dec);
+	if (op->f_epoch != tc->tc_mjed)
+	    tc_precess (tc, op->f_epoch, tc->tc_mjed, &ra, &dec);
 
 	/* compute astrometric @ requested equinox */
 	op->s_astrora = rpm;
@@ -256,21 +348,23 @@ obj_fixed (Now *np, Obj *op)
 	    precess (op->f_epoch, epoch, &op->s_astrora, &op->s_astrodec);
 
 	/* convert equatoreal ra/dec to mean geocentric ecliptic lat/long */
-	eq_ecl (mjed, ra, dec, &bet, &lam);
+	eq_ecl (tc->tc_mjed, ra, dec, &bet, &lam);
 
 	/* find solar ecliptical long.(mean equinox) and distance from earth */
-	sunpos (mjed, &lsn, &rsn, NULL);
+	lsn = tc->tc_lsn;
+	rsn = tc->tc_rsn;
 
 	/* allow for relativistic light bending near the sun */
-	deflect (mjed, lam, bet, rsn, lsn, 1e10, &ra, &dec);
+	if (tc->tc_acc != ACC_DISPLAY)
+	    deflect (tc->tc_mjed, lam, bet, rsn, lsn, 1e10, &ra, &dec);
 
 	/* TODO: correction for annual parallax would go here */
 
 	/* correct EOD equatoreal for nutation/aberation to form apparent 
 	 * geocentric
 	 */
-	nut_eq(mjed, &ra, &dec);
-	ab_eq(mjed, lsn, &ra, &dec);
+	tc_nut_eq (tc, &ra, &dec);
+	ab_eq(tc->tc_mjed, lsn, &ra, &dec);
 	op->s_gaera = ra;
 	op->s_gaedec = dec;
 
@@ -289,7 +383,7 @@ obj_fixed (Now *np, Obj *op)
 	*/
 
 	/* alt, az: correct for refraction; use eod ra/dec. */
-	now_lst (np, &lst);
+	tc_lst (tc, np, &lst);
 	ha = hrrad(lst) - ra;
 	hadec_aa (lat, ha, dec, &alt, &az);
 	refract (pressure, temp, alt, &alt);
@@ -303,7 +397,7 @@ obj_fixed (Now *np, Obj *op)
 /* compute sky circumstances of an object in heliocentric elliptic orbit at *np.
  */
 static int
-obj_elliptical (Now *np, Obj *op)
+obj_elliptical (Now *np, const TimeCtx *tc, Obj *op)
 {
 	double lsn, rsn;	/* true geoc lng of sun; dist from sn to earth*/
 	double dt;		/* light travel time to object */
@@ -329,7 +423,8 @@ obj_elliptical (Now *np, Obj *op)
 	int pass;
 
 	/* find location of earth from sun now */
-	sunpos (mjed, &lsn, &rsn, 0);
+	lsn = tc->tc_lsn;
+	rsn = tc->tc_rsn;
 	lg = lsn + PI;
 
 	/* mean daily motion is derived fro mean distance */
@@ -346,7 +441,7 @@ obj_elliptical (Now *np, Obj *op)
 					degrad (op->e_om), degrad (op->e_Om),
 					&inc, &om, &Om);
 
-	    tp = mjed - dt - (op->e_cepoch - op->e_M/e_n);
+	    tp = tc->tc_mjed - dt - (op->e_cepoch - op->e_M/e_n);
 	    if (vrc (&nu, &rp, tp, op->e_e, op->e_a*(1-op->e_e)) < 0)
 		op->o_flags |= NOCIRCUM;
 	    nu = degrad(nu);
@@ -380,7 +475,7 @@ obj_elliptical (Now *np, Obj *op)
 	bet = atan(rpd*spsi*sin(lam-lpd)/(cpsi*rsn*sll));
 
 	/* fill in all of op->s_* stuff except s_size and s_mag */
-	cir_sky (np, lpd, psi, rp, &rho, lam, bet, lsn, rsn, op);
+	cir_sky (np, tc, lpd, psi, rp, &rho, lam, bet, lsn, rsn, op);
 
 	/* compute magnitude and size */
 	if (op->e_mag.whichm == MAG_HG) {
@@ -404,7 +499,7 @@ obj_elliptical (Now *np, Obj *op)
 /* compute sky circumstances of an object in heliocentric hyperbolic orbit.
  */
 static int
-obj_hyperbolic (Now *np, Obj *op)
+obj_hyperbolic (Now *np, const TimeCtx *tc, Obj *op)
 {
 	double lsn, rsn;	/* true geoc lng of sun; dist from sn to earth*/
 	double dt;		/* light travel time to object */
@@ -431,7 +526,8 @@ obj_hyperbolic (Now *np, Obj *op)
 	int pass;
 
 	/* find solar ecliptical longitude and distance to sun from earth */
-	sunpos (mjed, &lsn, &rsn, 0);
+	lsn = tc->tc_lsn;
+	rsn = tc->tc_rsn;
 
 	lg = lsn + PI;
 	e = op->h_e;
@@ -448,7 +544,7 @@ obj_hyperbolic (Now *np, Obj *op)
 			    degrad (op->h_om), degrad (op->h_Om),
 			    &inc, &om, &Om);
 
-	    tp = mjed - dt - op->h_ep;
+	    tp = tc->tc_mjed - dt - op->h_ep;
 	    if (vrc (&nu, &rp, tp, op->h_e, op->h_qp) < 0)
 		op->o_flags |= NOCIRCUM;
 	    nu = degrad(nu);
@@ -482,7 +578,7 @@ obj_hyperbolic (Now *np, Obj *op)
 	bet = atan(rpd*spsi*sin(lam-lpd)/(cpsi*rsn*sll));
 
 	/* fill in all of op->s_* stuff except s_size and s_mag */
-	cir_sky (np, lpd, psi, rp, &rho, lam, bet, lsn, rsn, op);
+	cir_sky (np, tc, lpd, psi, rp, &rho, lam, bet, lsn, rsn, op);
 
 	/* compute magnitude and size */
 	gk_mag (op->h_g, op->h_k, rp, rho, &mag);
@@ -495,7 +591,7 @@ obj_hyperbolic (Now *np, Obj *op)
 /* compute sky circumstances of an object in heliocentric hyperbolic orbit.
  */
 static int
-obj_parabolic (Now *np, Obj *op)
+obj_parabolic (Now *np, const TimeCtx *tc, Obj *op)
 {
 	double lsn, rsn;	/* true geoc lng of sun; dist from sn to earth*/
 	double lam;    		/* geocentric ecliptic longitude */
@@ -507,20 +603,21 @@ obj_parabolic (Now *np, Obj *op)
 	int pass;
 
 	/* find solar ecliptical longitude and distance to sun from earth */
-	sunpos (mjed, &lsn, &rsn, 0);
+	lsn = tc->tc_lsn;
+	rsn = tc->tc_rsn;
 
 	/* two passes to correct lam and bet for light travel time. */
 	dt = 0.0;
 	for (pass = 0; pass < 2; pass++) {
 	    reduce_elements (op->p_epoch, mjd-dt, degrad(op->p_inc),
 		degrad(op->p_om), degrad(op->p_Om), &inc, &om, &Om);
-	    comet (mjed-dt, op->p_ep, inc, om, op->p_qp, Om,
+	    comet (tc->tc_mjed-dt, op->p_ep, inc, om, op->p_qp, Om,
 				    &lpd, &psi, &rp, &rho, &lam, &bet);
 	    dt = rho*LTAU/3600.0/24.0;	/* light travel time, in days / AU */
 	}
 
 	/* fill in all of op->s_* stuff except s_size and s_mag */
-	cir_sky (np, lpd, psi, rp, &rho, lam, bet, lsn, rsn, op);
+	cir_sky (np, tc, lpd, psi, rp, &rho, lam, bet, lsn, rsn, op);
 
 	/* compute magnitude and size */
 	gk_mag (op->p_g, op->p_k, rp, rho, &mag);
@@ -533,13 +630,15 @@ obj_parabolic (Now *np, Obj *op)
 /* find sun's circumstances now.
  */
 static int
-sun_cir (Now *np, Obj *op)
+sun_cir (Now *np, const TimeCtx *tc, Obj *op)
 {
 	double lsn, rsn;	/* true geoc lng of sun; dist from sn to earth*/
 	double bsn;		/* true latitude beta of sun */
 	double dhlong;
 
-	sunpos (mjed, &lsn, &rsn, &bsn);/* sun's true coordinates; mean ecl. */
+	lsn = tc->tc_lsn;	/* sun's true coordinates; mean ecl. */
+	rsn = tc->tc_rsn;
+	bsn = tc->tc_bsn;
 
 	op->s_sdist = 0.0;
 	op->s_elong = 0.0;
@@ -551,7 +650,7 @@ sun_cir (Now *np, Obj *op)
 	op->s_hlat = (float)(-bsn);
 
 	/* fill sun's ra/dec, alt/az in op */
-	cir_pos (np, bsn, lsn, &rsn, op);
+	cir_pos (np, tc, bsn, lsn, &rsn, op);
 	op->s_edist = (float)rsn;
 	op->s_size = (float)(raddeg(4.65242e-3/rsn)*3600*2);
 
@@ -561,7 +660,7 @@ sun_cir (Now *np, Obj *op)
 /* find moon's circumstances now.
  */
 static int
-moon_cir (Now *np, Obj *op)
+moon_cir (Now *np, const TimeCtx *tc, Obj *op)
 {
 	double lsn, rsn;	/* true geoc lng of sun; dist from sn to earth*/
 	double lam;    		/* geocentric ecliptic longitude */
@@ -572,8 +671,10 @@ moon_cir (Now *np, Obj *op)
 	double md;		/* moon's mean anomaly */
 	double i;
 
-	moon (mjed, &lam, &bet, &edistau, &ms, &md);	/* mean ecliptic & EOD*/
-	sunpos (mjed, &lsn, &rsn, NULL);		/* mean ecliptic & EOD*/
+	/* mean ecliptic & EOD */
+	moon (tc->tc_mjed, &lam, &bet, &edistau, &ms, &md);
+	lsn = tc->tc_lsn;
+	rsn = tc->tc_rsn;
 
 	op->s_hlong = (float)lam;		/* save geo in helio fields */
 	op->s_hlat = (float)bet;
@@ -596,7 +697,7 @@ moon_cir (Now *np, Obj *op)
 	op->s_phase = (float)((1+cos(PI-el-degrad(i)))/2*100);
 
 	/* fill moon's ra/dec, alt/az in op and update for topo dist */
-	cir_pos (np, bet, lam, &edistau, op);
+	cir_pos (np, tc, bet, lam, &edistau, op);
 
 	op->s_edist = (float)edistau;
 	op->s_size = (float)(3600*2.0*raddeg(asin(MRAD/MAU/edistau)));
@@ -611,6 +712,7 @@ moon_cir (Now *np, Obj *op)
 static void
 cir_sky (
 Now *np,
+const TimeCtx *tc,	/* quantities shared by everything at np */
 double lpd,		/* heliocentric ecliptic longitude */
 double psi,		/* heliocentric ecliptic lat */
 double rp,		/* dist from sun */
@@ -636,7 +738,7 @@ Obj *op)
 	op->s_hlat = (float)psi;
 
 	/* fill solar sys body's ra/dec, alt/az in op */
-	cir_pos (np, bet, lam, rho, op);        /* updates rho */
+	cir_pos (np, tc, bet, lam, rho, op);        /* updates rho */
 
 	/* set earth/planet and sun/planet distance */
 	op->s_edist = (float)(*rho);
@@ -672,6 +774,7 @@ Obj *op)
 static void
 cir_pos (
 Now *np,
+const TimeCtx *tc,	/* quantities shared by everything at np */
 double bet,	/* geo lat (mean ecliptic of date) */
 double lam,	/* geo long (mean ecliptic of date) */
 double *rho,	/* in: geocentric dist in AU; out: geo- or topocentic dist */
@@ -688,34 +791,37 @@ Obj *op)	/* object to set s_ra/dec as per equinox */
 	double rho_topo;        /* topocentric distance in earth radii */
 
 	/* convert to equatoreal [mean equator, with mean obliquity] */
-	ecl_eq (mjed, bet, lam, &ra, &dec);
+	ecl_eq (tc->tc_mjed, bet, lam, &ra, &dec);
 	tra = ra;	/* keep mean coordinates */
 	tdec = dec;
 
 	/* precess and save astrometric coordinates */
-	if (mjed != epoch)
-	    precess (mjed, epoch, &tra, &tdec);
+	if (tc->tc_mjed != epoch)
+	    tc_precess (tc, tc->tc_mjed, epoch, &tra, &tdec);
 	op->s_astrora = tra;
 	op->s_astrodec = tdec;
 
 	/* get sun position */
-	sunpos(mjed, &lsn, &rsn, NULL);
+	lsn = tc->tc_lsn;
+	rsn = tc->tc_rsn;
 
 	/* allow for relativistic light bending near the sun.
 	 * (avoid calling deflect() for the sun itself).
 	 */
-	if (!is_planet(op,SUN) && !is_planet(op,MOON))
-	    deflect (mjed, op->s_hlong, op->s_hlat, rsn, lsn, *rho, &ra, &dec);
+	if (!is_planet(op,SUN) && !is_planet(op,MOON)
+					&& tc->tc_acc != ACC_DISPLAY)
+	    deflect (tc->tc_mjed, op->s_hlong, op->s_hlat, rsn, lsn, *rho,
+							    &ra, &dec);
 
 	/* correct ra/dec to form geocentric apparent */
-	nut_eq (mjed, &ra, &dec);
+	tc_nut_eq (tc, &ra, &dec);
 	if (!is_planet(op,MOON))
-	    ab_eq (mjed, lsn, &ra, &dec);
+	    ab_eq (tc->tc_mjed, lsn, &ra, &dec);
 	op->s_gaera = ra;
 	op->s_gaedec = dec;
 
 	/* find parallax correction for equatoreal coords */
-	now_lst (np, &lst);
+	tc_lst (tc, np, &lst);
 	ha_in = hrrad(lst) - ra;
 	rho_topo = *rho * MAU/ERAD;             /* convert to earth radii */
 	ta_par (ha_in, dec, lat, elev, &rho_topo, &ha_out, &dec_out);
@@ -179,8 +179,6 @@ dpinit(SatData *sat, double EQSQ, double SINIQ, double COSIQ,
 #endif
     if(!sat->deep)
 	sat->deep = (struct deep_data *) malloc(sizeof(struct deep_data));
-    else
-	return;
 
     /* init_deep(sat->deep); */
     PREEP = 0.0;
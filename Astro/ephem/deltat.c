@@ -10,7 +10,7 @@
  * from The Astronomical Almanac and current IERS reports.
  * A table of values for the pre-telescopic period was taken from
  * Morrison and Stephenson (2004).  The overall tabulated range is
- * -1000.0 through 2018.0.  Values at intermediate times are interpolated
+ * -1000.0 through 2025.0.  Values at intermediate times are interpolated
  * from the tables.
  *
  * For dates earlier and later than the tabulated range, the program
@@ -18,7 +18,17 @@
  *
  * Updated deltaT predictions can be obtained from this network archive,
  *    http://maia.usno.navy.mil
- * then appended to the dt[] table and update TABEND.
+ * then appended to the dt[] table and update TABEND, or loaded at run
+ * time with deltat_load().
+ *
+ * Since deltat() is called for every ephemeris evaluation, the above is
+ * resampled once onto a uniform grid of DTG_STEP days over DTG_START
+ * through DTG_END, and deltat() interpolates that grid in constant time.
+ * The grid is built on first use and shared by all threads. deltat_load()
+ * builds a new one aside and swaps it in whole, so threads interpolating
+ * meanwhile see either grid, never a half built one. each grid carries
+ * the loaded values it was built from, which dates off the grid read, so
+ * those see one set or the other too.
  *
  * Input is XEphem's MJD, output is ET-UT in seconds.
  *
@@ -42,14 +52,28 @@
  *
  */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 #include "astro.h"
 
 #define TABSTART 1620
-#define TABEND 2018
+#define TABEND 2025
 #define TABSIZ (TABEND - TABSTART + 1)
 
+#define DTG_START 1620		/* first year of the grid */
+#define DTG_END 2200		/* last year of the grid */
+#define DTG_PERYEAR 8		/* grid points per year */
+#define DTG_STEP (365.25/DTG_PERYEAR)	/* grid spacing, days */
+#define DTG_SIZ ((DTG_END - DTG_START) * DTG_PERYEAR + 4)
+
 /* Morrison and Stephenson (2004)
  * This table covers -1000 through 1700 in 100-year steps.
  * Values are in whole seconds.
@@ -133,29 +157,254 @@ short dt[TABSIZ] = {
     3315, 3359, 3400, 3447, 3503, 3573, 3654, 3743, 3829, 3920,
     4018, 4117, 4223, 4337, 4449, 4548, 4646, 4752, 4853, 4959,
 
-    /* 1980.0 thru 2018.0 */
+    /* 1980.0 thru 2019.0 */
     5054, 5138, 5217, 5296, 5379, 5434, 5487, 5532, 5582, 5630,
     5686, 5757, 5831, 5912, 5998, 6078, 6163, 6230, 6297, 6347,
     6383, 6409, 6430, 6447, 6457, 6469, 6485, 6515, 6546, 6578,
-    6607, 6632, 6660, 6691, 6728, 6764, 6810, 6859, 6897,
+    6607, 6632, 6660, 6691, 6728, 6764, 6810, 6859, 6897, 6922,
+
+    /* 2020.0 thru 2025.0 */
+    6936, 6936, 6929, 6920, 6917, 6914,
 };
 
+/* the uniform grid, with the values loaded by deltat_load() it was built
+ * from so dates off the grid see the same ones.
+ */
+typedef struct {
+	double *ldt_mj, *ldt_dt;	/* loaded deltaT, sorted by date */
+	int nldt;			/* entries in them, 0 if none */
+	double ldt_offset;		/* joins the built-in values past them */
+	double grid[DTG_SIZ];
+} DTGrid;
+
+/* the current grid, the mjd of its first point and a count of the grids
+ * published. the first grid is static; those replaced by deltat_load() are
+ * never freed, nor their loaded values, as another thread may still be
+ * reading one.
+ */
+static DTGrid dtg_first;
+static DTGrid *dtg;
+static double dtg_mj0;
+static long dtg_gen;		/* bumped after each new dtg */
+
+/* dtg and dtg_gen are read without a lock, so a new grid is filled first and
+ * then published by one pointer store, the generation following it
+ */
+#ifdef _WIN32
+#define	DTG_GRID()	((DTGrid *) InterlockedCompareExchangePointer ((PVOID volatile *)&dtg, NULL, NULL))
+#define	DTG_GEN()	InterlockedCompareExchange (&dtg_gen, 0, 0)
+#define	DTG_PUBLISH(g)	(InterlockedExchangePointer ((PVOID volatile *)&dtg, (g)), \
+			    InterlockedIncrement (&dtg_gen))
+#else
+#define	DTG_GRID()	__atomic_load_n (&dtg, __ATOMIC_ACQUIRE)
+#define	DTG_GEN()	__atomic_load_n (&dtg_gen, __ATOMIC_ACQUIRE)
+#define	DTG_PUBLISH(g)	(__atomic_store_n (&dtg, (g), __ATOMIC_RELEASE), \
+			    __atomic_add_fetch (&dtg_gen, 1, __ATOMIC_RELEASE))
+#endif
+
+static double deltat_table (double mj);
+
+
+/* DeltaT at mj from the values loaded into g if they cover it, else from
+ * the built-in tables and formulas.
+ */
+static double
+deltat_eval (DTGrid *g, double mj)
+{
+	double *ldt_mj = g->ldt_mj, *ldt_dt = g->ldt_dt;
+	int lo, hi;
+
+	if (g->nldt == 0 || mj < ldt_mj[0])
+	    return (deltat_table (mj));
+	if (mj >= ldt_mj[g->nldt-1])
+	    return (deltat_table (mj) + g->ldt_offset);
+
+	lo = 0;
+	hi = g->nldt - 1;
+	while (hi - lo > 1) {
+	    int m = (lo + hi) / 2;
+	    if (ldt_mj[m] <= mj)
+		lo = m;
+	    else
+		hi = m;
+	}
+	return (ldt_dt[lo] + (mj - ldt_mj[lo]) * (ldt_dt[hi] - ldt_dt[lo])
+					    / (ldt_mj[hi] - ldt_mj[lo]));
+}
+
+/* fill the grid of g from its loaded values and make it dtg */
+static void
+dtg_build (DTGrid *g)
+{
+	int i;
+
+	for (i = 0; i < DTG_SIZ; i++)
+	    g->grid[i] = deltat_eval (g, dtg_mj0 + (i - 1) * DTG_STEP);
+	DTG_PUBLISH (g);
+}
+
+static void
+dtg_start (void)
+{
+	year_mjd (DTG_START, &dtg_mj0);
+	dtg_build (&dtg_first);
+}
+
+#ifdef _WIN32
+static INIT_ONCE dtg_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK
+dtg_once_cb (PINIT_ONCE once, PVOID param, PVOID *ctx)
+{
+	dtg_start();
+	return (TRUE);
+}
+
+static void
+dtg_init (void)
+{
+	InitOnceExecuteOnce (&dtg_once, dtg_once_cb, NULL, NULL);
+}
+#else
+static pthread_once_t dtg_once = PTHREAD_ONCE_INIT;
+
+static void
+dtg_init (void)
+{
+	pthread_once (&dtg_once, dtg_start);
+}
+#endif
 
 /* Given MJD return DeltaT = ET - UT1 in seconds.  Describes the irregularities
  * of the Earth rotation rate in the ET time scale.
+ * dtg[1] is at dtg_mj0, and a point has one more grid point either side of
+ * its interval for the Catmull-Rom spline through them.
  */
 double
 deltat(double mj)
 {
-	static double ans, lastmj;
+	static ASTRO_TLS double ans, lastmj;
+	static ASTRO_TLS long lastgen;
+	double u, f, p0, p1, p2, p3;
+	double *grid;
+	DTGrid *g;
+	long gen;
+	int i;
+
+	STAT_COUNT (STAT_DELTAT);
+	dtg_init();
+	gen = DTG_GEN();
+	if (mj == lastmj && lastgen == gen) {
+	    STAT_COUNT (STAT_DELTAT_HIT);
+	    return (ans);
+	}
+	lastmj = mj;
+	lastgen = gen;
+
+	g = DTG_GRID();
+	u = (mj - dtg_mj0) / DTG_STEP;
+	if (!(u >= 0 && u < DTG_SIZ - 3)) {
+	    ans = deltat_eval (g, mj);
+	    return (ans);
+	}
+
+	i = (int)u;
+	f = u - i;
+	grid = g->grid;
+	p0 = grid[i];
+	p1 = grid[i+1];
+	p2 = grid[i+2];
+	p3 = grid[i+3];
+	ans = p1 + 0.5 * f * (p2 - p0 + f * (2.0*p0 - 5.0*p1 + 4.0*p2 - p3
+					    + f * (3.0*(p1 - p2) + p3 - p0)));
+	return (ans);
+}
+
+/* load deltaT values from the text file fn, to be used over the dates it
+ * covers instead of the built-in table. each line holds either
+ *   year month day deltaT
+ * as in the USNO/IERS deltat.data, or
+ *   year deltaT
+ * with a decimal year; other lines are skipped. entries must be in date
+ * order. fn NULL goes back to the built-in table.
+ * returns the number of entries loaded, or -1 if fn can not be read or
+ * has none, in which case nothing changes.
+ */
+int
+deltat_load (char *fn)
+{
+	FILE *fp;
+	char line[256];
+	double *mjs = NULL, *dts = NULL;
+	DTGrid *g;
+	int n = 0, max = 0;
+
+	if (fn) {
+	    fp = fopen (fn, "r");
+	    if (!fp)
+		return (-1);
+	    while (fgets (line, sizeof(line), fp)) {
+		double a, b, c, d, mj;
+		int nf = sscanf (line, "%lf %lf %lf %lf", &a, &b, &c, &d);
+
+		if (nf == 4)
+		    cal_mjd ((int)b, c, (int)a, &mj);
+		else if (nf == 2) {
+		    year_mjd (a, &mj);
+		    d = b;
+		} else
+		    continue;
+		if (n > 0 && mj <= mjs[n-1])
+		    continue;
+
+		if (n == max) {
+		    max = max ? 2*max : 256;
+		    mjs = (double *) realloc (mjs, max * sizeof(double));
+		    dts = (double *) realloc (dts, max * sizeof(double));
+		    if (!mjs || !dts) {
+			fclose (fp);
+			free (mjs);
+			free (dts);
+			return (-1);
+		    }
+		}
+		mjs[n] = mj;
+		dts[n] = d;
+		n++;
+	    }
+	    fclose (fp);
+	    if (n < 2) {
+		free (mjs);
+		free (dts);
+		return (-1);
+	    }
+	}
+
+	g = (DTGrid *) malloc (sizeof(DTGrid));
+	if (!g) {
+	    free (mjs);
+	    free (dts);
+	    return (-1);
+	}
+
+	dtg_init();
+	g->ldt_mj = mjs;
+	g->ldt_dt = dts;
+	g->nldt = n;
+	g->ldt_offset = n > 0 ? dts[n-1] - deltat_table (mjs[n-1]) : 0;
+	dtg_build (g);
+	return (n);
+}
+
+/* DeltaT at mj from the built-in tables and formulas */
+static double
+deltat_table (double mj)
+{
+	double ans;
 	double Y, p, B;
 	int d[6];
 	int i, iy, k;
 
-	if (mj == lastmj)
-	    return (ans);
-	lastmj = mj;
-
 	mjd_year (mj, &Y);
 
 	if( Y > TABEND ) {
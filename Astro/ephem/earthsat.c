@@ -41,6 +41,7 @@
 typedef double MAT3x3[3][3];
 
 static int crazyOp (Now *np, Obj *op);
+static void esat_elem (Obj *op, SatElem *se);
 static void esat_prop (Now *np, Obj *op, double *SatX, double *SatY, double
     *SatZ, double *SatVX, double *SatVY, double *SatVZ);
 static void GetSatelliteParams (Obj *op);
@@ -66,6 +67,10 @@ static void GetTopocentric (double SatX, double SatY, double SatZ,
 static void GetBearings (double SatX, double SatY, double SatZ,
     double SiteX, double SiteY, double SiteZ, MAT3x3 SiteMatrix,
     double *Azimuth, double *Elevation);
+static double GetElevationRate (double SatX, double SatY, double SatVX,
+    double SatVY, double SatVZ, double SiteX, double SiteY, double SiteVX,
+    double SiteVY, MAT3x3 SiteMatrix, double Range, double RangeRate,
+    double Elevation);
 static int Eclipsed (double SatX, double SatY, double SatZ,
     double SatRadius, double CrntTime);
 static void InitOrbitRoutines (double EpochDay, int AtEod);
@@ -103,28 +108,28 @@ static void GetPrecession (double SemiMajorAxis, double Eccentricity,
 #define SunSemiMajorAxis  149598845.0  	    /* Kilometers 		   */
  
 /*  Keplerian Elements and misc. data for the satellite              */
-static double  EpochDay;                   /* time of epoch                 */
-static double EpochMeanAnomaly;            /* Mean Anomaly at epoch         */
-static long EpochOrbitNum;                 /* Integer orbit # of epoch      */
-static double EpochRAAN;                   /* RAAN at epoch                 */
-static double epochMeanMotion;             /* Revolutions/day               */
-static double OrbitalDecay;                /* Revolutions/day^2             */
-static double EpochArgPerigee;             /* argument of perigee at epoch  */
-static double Eccentricity;
-static double Inclination;
+static ASTRO_TLS double  EpochDay;                   /* time of epoch                 */
+static ASTRO_TLS double EpochMeanAnomaly;            /* Mean Anomaly at epoch         */
+static ASTRO_TLS long EpochOrbitNum;                 /* Integer orbit # of epoch      */
+static ASTRO_TLS double EpochRAAN;                   /* RAAN at epoch                 */
+static ASTRO_TLS double epochMeanMotion;             /* Revolutions/day               */
+static ASTRO_TLS double OrbitalDecay;                /* Revolutions/day^2             */
+static ASTRO_TLS double EpochArgPerigee;             /* argument of perigee at epoch  */
+static ASTRO_TLS double Eccentricity;
+static ASTRO_TLS double Inclination;
  
 /* Site Parameters */
-static double SiteLat,SiteLong,SiteAltitude;
+static ASTRO_TLS double SiteLat,SiteLong,SiteAltitude;
 
 
-static double SidDay,SidReference;	/* Date and sidereal time	*/
+static ASTRO_TLS double SidDay,SidReference;	/* Date and sidereal time	*/
 
 /* Keplerian elements for the sun */
-static double SunEpochTime,SunInclination,SunRAAN,SunEccentricity,
+static ASTRO_TLS double SunEpochTime,SunInclination,SunRAAN,SunEccentricity,
        SunArgPerigee,SunMeanAnomaly,SunMeanMotion;
 
 /* values for shadow geometry */
-static double SinPenumbra,CosPenumbra;
+static ASTRO_TLS double SinPenumbra,CosPenumbra;
 
 
 /* given a Now and an Obj with info about an earth satellite in the es_* fields
@@ -145,11 +150,14 @@ obj_earthsat (Now *np, Obj *op)
 	double Height;
 	double SSPLat,SSPLong;
 	double Azimuth,Elevation,Range;
+	double Refracted;
 	double RangeRate;
 	double dtmp;
 	double CrntTime;
 	double ra, dec;
 
+	STAT_COUNT (STAT_OBJ_EARTHSAT);
+
 #ifdef ESAT_TRACE
 	printf ("\n");
 	printf ("Name = %s\n", op->o_name);
@@ -190,8 +198,8 @@ obj_earthsat (Now *np, Obj *op)
 		    &Azimuth,&Elevation);
 
 	op->s_az = Azimuth;
-	refract (pressure, temp, Elevation, &dtmp);
-	op->s_alt = dtmp;
+	refract (pressure, temp, Elevation, &Refracted);
+	op->s_alt = Refracted;
 
 	/* Range: line-of-site distance to satellite, m
 	 * RangeRate: m/s
@@ -201,6 +209,18 @@ obj_earthsat (Now *np, Obj *op)
 
 	op->s_range = (float)(Range*1000);	/* we want m */
 	op->s_rangev = (float)(RangeRate*1000);	/* we want m/s */
+
+	/* rate of the refracted altitude, by the chain rule through the
+	 * slope of the refraction at Elevation. the altitude itself is kept
+	 * as a double, s_alt being too coarse a float for the difference.
+	 */
+	dtmp = GetElevationRate(SatX,SatY,SatVX,SatVY,SatVZ,
+	    SiteX,SiteY,SiteVX,SiteVY,SiteMatrix,Range,RangeRate,Elevation);
+	{
+	    double aa1;
+	    refract (pressure, temp, Elevation + 1e-4, &aa1);
+	    op->s_altv = (float)(dtmp * (aa1 - Refracted) / 1e-4);
+	}
  
 	/* SSPLat: sub-satellite latitude, rads 
 	 * SSPLong: sub-satellite longitude, >0 west, rads 
@@ -329,68 +349,48 @@ double *SatVX, double *SatVY, double *SatVZ)
 #else	/* ! USE_ORBIT_PROPAGATOR */
 #define	MPD		1440.0		/* minutes per day */
 
+	static ASTRO_TLS SatProp last_sp;		/* last element set seen w/o es_prop */
+	static ASTRO_TLS int last_valid;
+	const SatProp *sp;
 	SatElem se;
-	SatData sd;
 	Vec3 posvec, velvec;
-	double dy;
 	double dt;
-	int yr;
 
 	if (crazyOp (np, op)) {
 	    *SatX = *SatY = *SatZ = *SatVX = *SatVY = *SatVZ = 0;
 	    return;
 	}
 
-	/* init */
-	memset ((void *)&se, 0, sizeof(se));
-	memset ((void *)&sd, 0, sizeof(sd));
-	sd.elem = &se;
-
-	/* se_EPOCH is packed as yr*1000 + dy, where yr is years since 1900
-	 * and dy is day of year, Jan 1 being 1
-	 */
-	mjd_dayno (op->es_epoch, &yr, &dy);
-	yr -= 1900;
-	dy += 1;
-	se.se_EPOCH = yr*1000 + dy;
-
-	/* others carry over with some change in units */
-	se.se_XNO = op->es_n * (2*PI/MPD);	/* revs/day to rads/min */
-	se.se_XINCL = (float)degrad(op->es_inc);
-	se.se_XNODEO = (float)degrad(op->es_raan);
-	se.se_EO = op->es_e;
-	se.se_OMEGAO = (float)degrad(op->es_ap);
-	se.se_XMO = (float)degrad(op->es_M);
-	se.se_BSTAR = op->es_drag;
-	se.se_XNDT20 = op->es_decay*(2*PI/MPD/MPD); /*rv/dy^^2 to rad/min^^2*/
-
-	se.se_id.orbit = op->es_orbit;
+	/* init, unless op or the previous call already did */
+	if (op->es_prop)
+	    sp = op->es_prop;
+	else {
+	    esat_elem (op, &se);
+	    if (!last_valid || memcmp (&se, &last_sp.elem, sizeof(se))) {
+		sat_prop_init (&last_sp, &se);
+		last_valid = 1;
+	    }
+	    sp = &last_sp;
+	}
 
 	dt = (mjd-op->es_epoch)*MPD;
 
 #ifdef ESAT_TRACE
-	printf ("se_EPOCH  : %30.20f\n", se.se_EPOCH);
-	printf ("se_XNO    : %30.20f\n", se.se_XNO);
-	printf ("se_XINCL  : %30.20f\n", se.se_XINCL);
-	printf ("se_XNODEO : %30.20f\n", se.se_XNODEO);
-	printf ("se_EO     : %30.20f\n", se.se_EO);
-	printf ("se_OMEGAO : %30.20f\n", se.se_OMEGAO);
-	printf ("se_XMO    : %30.20f\n", se.se_XMO);
-	printf ("se_BSTAR  : %30.20f\n", se.se_BSTAR);
-	printf ("se_XNDT20 : %30.20f\n", se.se_XNDT20);
-	printf ("se_orbit  : %30d\n",    se.se_id.orbit);
+	printf ("se_EPOCH  : %30.20f\n", sp->elem.se_EPOCH);
+	printf ("se_XNO    : %30.20f\n", sp->elem.se_XNO);
+	printf ("se_XINCL  : %30.20f\n", sp->elem.se_XINCL);
+	printf ("se_XNODEO : %30.20f\n", sp->elem.se_XNODEO);
+	printf ("se_EO     : %30.20f\n", sp->elem.se_EO);
+	printf ("se_OMEGAO : %30.20f\n", sp->elem.se_OMEGAO);
+	printf ("se_XMO    : %30.20f\n", sp->elem.se_XMO);
+	printf ("se_BSTAR  : %30.20f\n", sp->elem.se_BSTAR);
+	printf ("se_XNDT20 : %30.20f\n", sp->elem.se_XNDT20);
+	printf ("se_orbit  : %30d\n",    sp->elem.se_id.orbit);
 	printf ("dt        : %30.20f\n", dt);
 #endif /* ESAT_TRACE */
 
 	/* compute the state vectors */
-	if (se.se_XNO >= (1.0/225.0))
-	    sgp4(&sd, &posvec, &velvec, dt); /* NEO */
-	else
-	    sdp4(&sd, &posvec, &velvec, dt); /* GEO */
-	if (sd.prop.sgp4)
-	    free (sd.prop.sgp4);	/* sd.prop.sdp4 is in same union */
-	if (sd.deep)
-	    free (sd.deep);
+	sat_prop (sp, &posvec, &velvec, dt);
 
  	/* earth radii to km */
  	*SatX = (ERAD/1000)*posvec.x;	
@@ -404,6 +404,131 @@ double *SatVX, double *SatVY, double *SatVZ)
 #endif
 }
 
+#ifndef USE_ORBIT_PROPAGATOR
+/* fill se from the earth satellite elements of op, in sgp4/sdp4 units */
+static void
+esat_elem (Obj *op, SatElem *se)
+{
+	double dy;
+	int yr;
+
+	memset ((void *)se, 0, sizeof(*se));
+
+	/* se_EPOCH is packed as yr*1000 + dy, where yr is years since 1900
+	 * and dy is day of year, Jan 1 being 1
+	 */
+	mjd_dayno (op->es_epoch, &yr, &dy);
+	yr -= 1900;
+	dy += 1;
+	se->se_EPOCH = yr*1000 + dy;
+
+	/* others carry over with some change in units */
+	se->se_XNO = op->es_n * (2*PI/MPD);	/* revs/day to rads/min */
+	se->se_XINCL = (float)degrad(op->es_inc);
+	se->se_XNODEO = (float)degrad(op->es_raan);
+	se->se_EO = op->es_e;
+	se->se_OMEGAO = (float)degrad(op->es_ap);
+	se->se_XMO = (float)degrad(op->es_M);
+	se->se_BSTAR = op->es_drag;
+	se->se_XNDT20 = op->es_decay*(2*PI/MPD/MPD); /*rv/dy^^2 to rad/min^^2*/
+
+	se->se_id.orbit = op->es_orbit;
+}
+
+/* initialise the propagator state for se in sp, using no storage but sp */
+void
+sat_prop_init (SatProp *sp, const SatElem *se)
+{
+	SatData sd;
+	Vec3 posvec, velvec;
+
+	memset ((void *)sp, 0, sizeof(*sp));
+	sp->elem = *se;
+	sd.elem = &sp->elem;
+	sd.deep = &sp->deep;
+	sd.init = 0;
+
+	/* propagating to the epoch runs the one-time initialisation */
+	if (se->se_XNO >= (1.0/225.0)) {
+	    sd.prop.sgp4 = &sp->prop.sgp4;
+	    sgp4(&sd, &posvec, &velvec, 0.0); /* NEO */
+	} else {
+	    sd.prop.sdp4 = &sp->prop.sdp4;
+	    sdp4(&sd, &posvec, &velvec, 0.0); /* GEO */
+	}
+}
+
+/* propagate the element set initialised in sp to TSINCE minutes from its
+ * epoch. sp is left untouched, so every call starts from the same state and
+ * gives the same answer as a freshly initialised propagator would.
+ */
+void
+sat_prop (const SatProp *sp, Vec3 *pos, Vec3 *dpos, double TSINCE)
+{
+	struct sdp4_data sdp4d;
+	struct deep_data deep;
+	SatData sd;
+
+	sd.elem = (SatElem *)&sp->elem;
+	sd.init = 1;
+
+	if (sp->elem.se_XNO >= (1.0/225.0)) {
+	    sd.prop.sgp4 = (struct sgp4_data *)&sp->prop.sgp4;
+	    sd.deep = NULL;
+	    sgp4(&sd, pos, dpos, TSINCE); /* NEO */
+	} else {
+	    /* sdp4 keeps updating its deep-space integrator and a few of its
+	     * own fields, so those work on copies.
+	     */
+	    sdp4d = sp->prop.sdp4;
+	    deep = sp->deep;
+	    sd.prop.sdp4 = &sdp4d;
+	    sd.deep = &deep;
+	    sdp4(&sd, pos, dpos, TSINCE); /* GEO */
+	}
+}
+#endif /* !USE_ORBIT_PROPAGATOR */
+
+/* initialise the sgp4/sdp4 state of the earth satellite op once and keep it
+ * in op->es_prop, so later obj_earthsat() calls on op, or on plain copies of
+ * it, only propagate. op may be shared between threads as long as nobody
+ * changes its elements. release with esat_free().
+ * return 0 if ok, else -1.
+ */
+int
+esat_init (Obj *op)
+{
+#ifdef USE_ORBIT_PROPAGATOR
+	return (-1);
+#else
+	SatElem se;
+	SatProp *sp;
+
+	if (op->o_type != EARTHSAT)
+	    return (-1);
+	esat_free (op);
+
+	sp = (SatProp *) malloc (sizeof(SatProp));
+	if (!sp)
+	    return (-1);
+	esat_elem (op, &se);
+	sat_prop_init (sp, &se);
+
+	op->es_prop = sp;
+	return (0);
+#endif
+}
+
+/* release the state set up by esat_init(), if any */
+void
+esat_free (Obj *op)
+{
+	if (op->o_type != EARTHSAT || !op->es_prop)
+	    return;
+	free (op->es_prop);
+	op->es_prop = NULL;
+}
+
 /* return 1 if op is crazy @ np */
 static int
 crazyOp (Now *np, Obj *op)
@@ -623,10 +748,10 @@ GetSitPosition(double SiteLat, double SiteLong, double SiteElevation,
 double CrntTime, double *SiteX, double *SiteY, double *SiteZ, double *SiteVX,
 double *SiteVY, MAT3x3 SiteMatrix)
 {
-    static double G1,G2; /* Used to correct for flattening of the Earth */
-    static double CosLat,SinLat;
-    static double OldSiteLat = -100000;  /* Used to avoid unneccesary recomputation */
-    static double OldSiteElevation = -100000;
+    static ASTRO_TLS double G1,G2; /* Used to correct for flattening of the Earth */
+    static ASTRO_TLS double CosLat,SinLat;
+    static ASTRO_TLS double OldSiteLat = -100000;  /* Used to avoid unneccesary recomputation */
+    static ASTRO_TLS double OldSiteElevation = -100000;
     double Lat;
     double SiteRA;	/* Right Ascension of site			*/
     double CosRA,SinRA;
@@ -722,6 +847,32 @@ double *Elevation)
 	*Azimuth += PI;
 }
 
+/* Rate of change of the elevation found by GetBearings, radians/second.
+   The height of the satellite above the site's horizon plane is the
+   line of sight projected on the site's zenith, which turns with the
+   earth, and Elevation is asin of that height over Range. */
+
+static double
+GetElevationRate(double SatX, double SatY, double SatVX, double SatVY,
+double SatVZ, double SiteX, double SiteY, double SiteVX, double SiteVY,
+MAT3x3 SiteMatrix, double Range, double RangeRate, double Elevation)
+{
+    double DX,DY;
+    double HeightRate;
+    double CosEl;
+
+    DX = SatX - SiteX; DY = SatY - SiteY;
+
+    HeightRate = SiteMatrix[2][0]*(SatVX-SiteVX)
+	+ SiteMatrix[2][1]*(SatVY-SiteVY) + SiteMatrix[2][2]*SatVZ
+	+ SidRate*(SiteMatrix[2][0]*DY - SiteMatrix[2][1]*DX);
+
+    CosEl = cos(Elevation);
+    if (CosEl < 1e-9)
+	return 0;
+    return (HeightRate - sin(Elevation)*RangeRate)/(Range*CosEl);
+}
+
 static int
 Eclipsed(double SatX, double SatY, double SatZ, double SatRadius,
 double CrntTime)
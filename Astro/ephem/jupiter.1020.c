@@ -4246,5 +4246,6 @@ BDL_Dataset jupiter_1020 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
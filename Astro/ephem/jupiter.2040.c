@@ -7702,5 +7702,6 @@ BDL_Dataset jupiter_2040 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
@@ -4642,5 +4642,6 @@ BDL_Dataset jupiter_9910 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
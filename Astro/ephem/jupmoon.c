@@ -17,17 +17,17 @@ static void moonPShad (Obj *sop, Obj *jop, MoonData md[J_NMOONS]);
 static void moonTrans (MoonData md[J_NMOONS]);
 
 /* moon table and a few other goodies and when it was last computed */
-static double mdmjd = -123456;
-static MoonData jmd[J_NMOONS] = {
+static ASTRO_TLS double mdmjd = -123456;
+static ASTRO_TLS MoonData jmd[J_NMOONS] = {
     {"Jupiter", NULL},
     {"Io", "I"},
     {"Europa", "II"},
     {"Ganymede", "III"},
     {"Callisto", "IV"}
 };
-static double sizemjd;	/* size at last mjd */
-static double cmlImjd;	/* central meridian long sys I, at last mjd */
-static double cmlIImjd;	/*    "                      II      " */
+static ASTRO_TLS double sizemjd;	/* size at last mjd */
+static ASTRO_TLS double cmlImjd;	/* central meridian long sys I, at last mjd */
+static ASTRO_TLS double cmlIImjd;	/*    "                      II      " */
 
 /* These values are from the Explanatory Supplement.
  * Precession degrades them gradually over time.
@@ -130,16 +130,9 @@ MoonData md[J_NMOONS])	/* fill md[1..NM-1].x/y/z for each moon */
 	BDL_Dataset *dataset;
 	int i;
 
-	/* check ranges and appropriate data file */
-	if (JD < 2451179.50000)		/* Jan 1 1999 UTC */
-	    return (-1);
-	if (JD < 2455562.5)		/* Jan 1 2011 UTC */
-	    dataset = & jupiter_9910;
-	else if (JD < 2459215.5)	/* Jan 1 2021 UTC */
-            dataset = & jupiter_1020;
-        else if (JD < 2466520.5)        /* Jan 1 2041 UTC */
-            dataset = & jupiter_2040;
-	else
+	/* find the appropriate data set */
+	dataset = bdl_dataset (JUPITER, JD);
+	if (!dataset)
 	    return (-1);
 
 	/* use it */
@@ -1654,5 +1654,6 @@ BDL_Dataset mars_1020 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
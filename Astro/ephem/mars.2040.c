@@ -2986,5 +2986,6 @@ BDL_Dataset mars_2040 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
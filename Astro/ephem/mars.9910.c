@@ -1798,5 +1798,6 @@ BDL_Dataset mars_9910 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
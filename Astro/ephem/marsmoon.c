@@ -17,13 +17,13 @@ static void moonPShad (Obj *sop, Obj *mop, MoonData md[M_NMOONS]);
 static void moonTrans (MoonData md[M_NMOONS]);
 
 /* moon table and a few other goodies and when it was last computed */
-static double mdmjd = -123456;
-static MoonData mmd[M_NMOONS] = {
+static ASTRO_TLS double mdmjd = -123456;
+static ASTRO_TLS MoonData mmd[M_NMOONS] = {
     {"Mars", NULL},
     {"Phobos", "I"},
     {"Deimos", "II"},
 };
-static double sizemjd;
+static ASTRO_TLS double sizemjd;
 
 /* These values are from the Explanatory Supplement.
  * Precession degrades them gradually over time.
@@ -120,16 +120,9 @@ MoonData md[M_NMOONS])	/* fill md[1..NM-1].x/y/z for each moon */
 	BDL_Dataset *dataset;
 	int i;
 
-	/* check ranges and appropriate data file */
-	if (JD < 2451179.50000)		/* Jan 1 1999 UTC */
-	    return (-1);
-	if (JD < 2455562.5)		/* Jan 1 2011 UTC */
-            dataset = & mars_9910;
-	else if (JD < 2459215.5)	/* Jan 1 2021 UTC */
-	    dataset = & mars_1020;
-        else if (JD < 2466520.5)        /* Jan 1 2041 UTC */
-            dataset = & mars_2040;
-	else
+	/* find the appropriate data set */
+	dataset = bdl_dataset (MARS, JD);
+	if (!dataset)
 	    return (-1);
 
 	/* use it */
@@ -142,8 +142,8 @@ obj_description (Obj *op)
 	    }
 	    return ("Binary system");
 	case PLANET: {
-	    static char nsstr[MAXNM + 9];
-	    static Obj *biop;
+	    static ASTRO_TLS char nsstr[MAXNM + 9];
+	    static ASTRO_TLS Obj *biop;
 
 	    if (op->pl_code == SUN)
 		return ("Star");
@@ -170,7 +170,7 @@ obj_description (Obj *op)
 void
 now_lst (Now *np, double *lstp)
 {
-	static double last_mjd = -23243, last_lng = 121212, last_lst;
+	static ASTRO_TLS double last_mjd = -23243, last_lng = 121212, last_lst;
 	double eps, lst, deps, dpsi;
 
 	if (last_mjd == mjd && last_lng == lng) {
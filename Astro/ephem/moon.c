@@ -91,6 +91,27 @@ static double g1plan (double J, struct plantbl *plan);
 static int gecmoon (double J, struct plantbl *lrtab,
 	struct plantbl *lattab, double *pobj);
 
+/* dates evaluated together by moon_n() */
+#define MOON_BATCH 16
+
+/* the multiple angle tables of a batch of dates, with the date innermost
+ * so each term of the series is applied to all of them along contiguous
+ * memory.
+ */
+struct moonbatch {
+  int n;			/* dates in use */
+  int idx[MOON_BATCH];		/* index of each in the caller's arrays */
+  double J[MOON_BATCH];		/* Julian ephemeris date, light time applied */
+  double LP[MOON_BATCH];	/* LP_equinox */
+  double ms[MOON_BATCH];	/* Args[11] */
+  double md[MOON_BATCH];	/* Args[12] */
+  double ss[NARGS][30][MOON_BATCH];
+  double cc[NARGS][30][MOON_BATCH];
+};
+
+static void gnplan (struct plantbl *plan, struct moonbatch *b,
+	double sl[], double sr[]);
+
 /* time points */
 #define MOSHIER_J2000 (2451545.0)
 
@@ -98,19 +119,19 @@ static int gecmoon (double J, struct plantbl *lrtab,
 #define MOSHIER_END   (2798525.5 - MJD0) /* 2950.0; from libration table */
 
 
-static double Args[NARGS];
-static double LP_equinox;
-static double NF_arcsec;
-static double Ea_arcsec;
-static double pA_precession;
+static ASTRO_TLS double Args[NARGS];
+static ASTRO_TLS double LP_equinox;
+static ASTRO_TLS double NF_arcsec;
+static ASTRO_TLS double Ea_arcsec;
+static ASTRO_TLS double pA_precession;
 
 
 /* This storage ought to be allocated dynamically.  */
-double ss[NARGS][30];
-double cc[NARGS][30];
+ASTRO_TLS double ss[NARGS][30];
+ASTRO_TLS double cc[NARGS][30];
 
 /* Time, in units of 10,000 Julian years from JED 2451545.0.  */
-static double T;
+static ASTRO_TLS double T;
 
 /* Conversion factors between degrees and radians */
 #define DTR 1.7453292519943295769e-2
@@ -3275,6 +3296,128 @@ gecmoon (double J, struct plantbl *lrtab, struct plantbl *lattab, double pobj[])
   return 0;
 }
 
+/* as g2plan(), or g1plan() when sr is NULL, for all the dates of batch b
+ * in one pass over the tables. each date sees the same arithmetic in the
+ * same order as it would there, so the results are identical.
+ */
+static void
+gnplan (struct plantbl *plan, struct moonbatch *b, double sl[], double sr[])
+{
+  int j, k, m, k1, ip, np, nt, d;
+  int n = b->n;
+  CHAR *p;
+  long *pl, *pr;
+  const double *su, *cu;
+  double T[MOON_BATCH], sv[MOON_BATCH], cv[MOON_BATCH];
+  double sgn, s, c, t;
+
+  for (d = 0; d < n; d++)
+    {
+      T[d] = (b->J[d] - MOSHIER_J2000) / plan->timescale;
+      sl[d] = 0.0;
+      if (sr)
+	sr[d] = 0.0;
+    }
+
+  p = plan->arg_tbl;
+  pl = plan->lon_tbl;
+  pr = plan->rad_tbl;
+
+  for (;;)
+    {
+      np = *p++;
+      if (np < 0)
+	break;
+      if (np == 0)
+	{			/* It is a polynomial term.  */
+	  nt = *p++;
+	  for (d = 0; d < n; d++)
+	    {
+	      c = pl[0];
+	      for (ip = 0; ip < nt; ip++)
+		c = c * T[d] + pl[ip+1];
+	      sl[d] += c;
+	    }
+	  pl += nt + 1;
+	  if (sr)
+	    {
+	      for (d = 0; d < n; d++)
+		{
+		  c = pr[0];
+		  for (ip = 0; ip < nt; ip++)
+		    c = c * T[d] + pr[ip+1];
+		  sr[d] += c;
+		}
+	      pr += nt + 1;
+	    }
+	  continue;
+	}
+      k1 = 0;
+      for (ip = 0; ip < np; ip++)
+	{
+	  j = *p++;
+	  m = *p++ - 1;
+	  if (j)
+	    {
+	      k = abs (j) - 1;
+	      sgn = j < 0 ? -1.0 : 1.0;
+	      su = b->ss[m][k];
+	      cu = b->cc[m][k];
+	      if (k1 == 0)
+		{		/* set first angle */
+		  for (d = 0; d < n; d++)
+		    {
+		      sv[d] = sgn * su[d];
+		      cv[d] = cu[d];
+		    }
+		  k1 = 1;
+		}
+	      else
+		{		/* combine angles */
+		  for (d = 0; d < n; d++)
+		    {
+		      s = sgn * su[d];
+		      t = s * cv[d] + cu[d] * sv[d];
+		      cv[d] = cu[d] * cv[d] - s * sv[d];
+		      sv[d] = t;
+		    }
+		}
+	    }
+	}
+      if (k1 == 0)
+	for (d = 0; d < n; d++)
+	  sv[d] = cv[d] = 0.0;
+      nt = *p++;
+      for (d = 0; d < n; d++)
+	{
+	  c = pl[0];
+	  s = pl[1];
+	  for (ip = 0; ip < nt; ip++)
+	    {
+	      c = c * T[d] + pl[2*ip+2];
+	      s = s * T[d] + pl[2*ip+3];
+	    }
+	  sl[d] += c * cv[d] + s * sv[d];
+	}
+      pl += 2*(nt + 1);
+      if (sr)
+	{
+	  for (d = 0; d < n; d++)
+	    {
+	      c = pr[0];
+	      s = pr[1];
+	      for (ip = 0; ip < nt; ip++)
+		{
+		  c = c * T[d] + pr[2*ip+2];
+		  s = s * T[d] + pr[2*ip+3];
+		}
+	      sr[d] += c * cv[d] + s * sv[d];
+	    }
+	  pr += 2*(nt + 1);
+	}
+    }
+}
+
 /*********** end stephen moshier's moon code ****************/
 
 static void moon_fast (double mj, double *lam, double *bet,
@@ -3442,8 +3585,21 @@ double *mdp)
 {
 	double pobj[3], dt;
 	double hp;
+	double ret[5];
+
+	STAT_COUNT (STAT_MOON);
+	if (ephc_get (MOON, mj, ret) == 0) {
+		*lam = ret[0];
+		*bet = ret[1];
+		*rho = ret[2];
+		*msp = ret[3];
+		*mdp = ret[4];
+		return;
+	}
 
-	if (mj >= MOSHIER_BEGIN && mj <= MOSHIER_END) {
+	/* moon_fast() alone is good enough for ACC_DISPLAY */
+	if (mj >= MOSHIER_BEGIN && mj <= MOSHIER_END
+					&& astro_accuracy() != ACC_DISPLAY) {
 		/* retard for light time */
 		moon_fast (mj, lam, bet, &hp, msp, mdp);
 		*rho = EarthRadius/AUKM/sin(hp);
@@ -3463,3 +3619,101 @@ double *mdp)
 	}
 }
 
+/* add Julian ephemeris date J, for the caller's entry i, to batch b */
+static void
+moon_add (struct moonbatch *b, int i, double J)
+{
+	int d = b->n++;
+	int a, h, k;
+
+	mean_elements (J);
+	for (a = 0; a < NARGS; a++) {
+	    h = moonlr.max_harmonic[a];
+	    if (moonlat.max_harmonic[a] > h)
+		h = moonlat.max_harmonic[a];
+	    if (h > 0) {
+		sscc (a, Args[a], h);
+		for (k = 0; k < h; k++) {
+		    b->ss[a][k][d] = ss[a][k];
+		    b->cc[a][k][d] = cc[a][k];
+		}
+	    }
+	}
+	b->idx[d] = i;
+	b->J[d] = J;
+	b->LP[d] = LP_equinox;
+	b->ms[d] = Args[11];
+	b->md[d] = Args[12];
+}
+
+/* evaluate batch b into the caller's arrays, as gecmoon() and moon() */
+static void
+moon_flush (struct moonbatch *b, double *lam, double *bet, double *rho,
+double *msp, double *mdp)
+{
+	double sl[MOON_BATCH], sr[MOON_BATCH], sb[MOON_BATCH];
+	double x;
+	int d, i;
+
+	gnplan (&moonlr, b, sl, sr);
+	gnplan (&moonlat, b, sb, NULL);
+
+	for (d = 0; d < b->n; d++) {
+	    i = b->idx[d];
+	    x = moonlr.trunclvl * sl[d];
+	    x += b->LP[d];
+	    if (x < -6.45e5)
+		x += 1.296e6;
+	    if (x > 6.45e5)
+		x -= 1.296e6;
+	    lam[i] = STR * x;
+	    range (&lam[i], 2*PI);
+	    bet[i] = STR * (moonlat.trunclvl * sb[d]);
+	    rho[i] = (STR * (moonlr.trunclvl * sr[d]) + 1.0) * moonlr.distance;
+	    msp[i] = STR * b->ms[d];
+	    mdp[i] = STR * b->md[d];
+	}
+	b->n = 0;
+}
+
+/* moon() for n dates m[], results in the corresponding entries of the
+ * other arrays. dates within the Moshier theory are gathered into batches
+ * and each batch is summed in a single pass over its term tables, which
+ * is where moon() spends most of its time. results equal those of moon(),
+ * at the same astro_accuracy().
+ */
+void
+moon_n (int n, const double *m, double *lam, double *bet, double *rho,
+double *msp, double *mdp)
+{
+	struct moonbatch *b;
+	double ret[5], hp, dt, l, be, ms, md;
+	int fast = astro_accuracy() == ACC_DISPLAY;
+	int i;
+
+	b = fast ? NULL : (struct moonbatch *) malloc (sizeof(struct moonbatch));
+	if (b)
+	    b->n = 0;
+
+	/* moon() does it all when there is no batch, so also for ACC_DISPLAY */
+	for (i = 0; i < n; i++) {
+	    if (!b || m[i] < MOSHIER_BEGIN || m[i] > MOSHIER_END
+					    || ephc_get (MOON, m[i], ret) == 0) {
+		moon (m[i], &lam[i], &bet[i], &rho[i], &msp[i], &mdp[i]);
+		continue;
+	    }
+
+	    /* retard for light time */
+	    moon_fast (m[i], &l, &be, &hp, &ms, &md);
+	    dt = EarthRadius/AUKM/sin(hp) * 5.7755183e-3;
+	    moon_add (b, i, m[i] + MJD0 - dt);
+	    if (b->n == MOON_BATCH)
+		moon_flush (b, lam, bet, rho, msp, mdp);
+	}
+
+	if (b) {
+	    if (b->n > 0)
+		moon_flush (b, lam, bet, rho, msp, mdp);
+	    free ((void *)b);
+	}
+}
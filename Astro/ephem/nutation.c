@@ -276,23 +276,28 @@ double mj,
 double *deps,	/* on input:  precision parameter in arc seconds */
 double *dpsi)
 {
-	static double lastmj = -10000, lastdeps, lastdpsi;
+	static double acc_prec[] = {0.0, 0.01, 0.1};	/* by ACC_*, arc sec */
+	static ASTRO_TLS double lastmj = -10000, lastdeps, lastdpsi;
+	static ASTRO_TLS int lastacc;
+	int acc = astro_accuracy();
 	double T, T2, T3, T10;			/* jul cent since J2000 */
 	double prec;				/* series precis in arc sec */
 	int i, isecul;				/* index in term table */
-	static double delcache[5][2*NUT_MAXMUL+1];
+	static ASTRO_TLS double delcache[5][2*NUT_MAXMUL+1];
 			/* cache for multiples of delaunay args
 			 * [M',M,F,D,Om][-min*x, .. , 0, .., max*x]
 			 * make static to have unfilled fields cleared on init
 			 */
 
-	if (mj == lastmj) {
+	STAT_COUNT (STAT_NUTATION);
+	if (mj == lastmj && acc == lastacc) {
+	    STAT_COUNT (STAT_NUTATION_HIT);
 	    *deps = lastdeps;
 	    *dpsi = lastdpsi;
 	    return;
 	}
 
-	prec = 0.0;
+	prec = acc_prec[acc];
 
 #if 0	/* this is if deps should contain a precision value */
 	prec =* deps;
@@ -362,6 +367,7 @@ double *dpsi)
 	lastdeps = degrad(lastdeps/3600./NUT_SCALE);
 
 	lastmj = mj;
+	lastacc = acc;
 	*deps = lastdeps;
 	*dpsi = lastdpsi;
 }
@@ -372,61 +378,19 @@ double *dpsi)
 void
 nut_eq (double mj, double *ra, double *dec)
 {
-	static double lastmj = -10000;
-	static double a[3][3];		/* rotation matrix */
+	static ASTRO_TLS double lastmj = -10000;
+	static ASTRO_TLS int lastacc;
+	static ASTRO_TLS double a[3][3];		/* rotation matrix */
 	double xold, yold, zold, x, y, z;
 
-	if (mj != lastmj) {
+	if (mj != lastmj || astro_accuracy() != lastacc) {
 	    double epsilon, dpsi, deps;
-	    double se, ce, sp, cp, sede, cede;
 
 	    obliquity(mj, &epsilon);
 	    nutation(mj, &deps, &dpsi);
-
-	    /* the rotation matrix a applies the nutation correction to
-	     * a vector of equatoreal coordinates Xeq to Xeq' by 3 subsequent
-	     * rotations:  R1 - from equatoreal to ecliptic system by
-	     * rotation of angle epsilon about x, R2 - rotate ecliptic
-	     * system by -dpsi about its z, R3 - from ecliptic to equatoreal
-	     * by rotation of angle -(epsilon + deps)
-	     *
-	     *	Xeq' = A * Xeq = R3 * R2 * R1 * Xeq
-	     * 
-	     *		[ 1       0          0    ]
-	     * R1 =	[ 0   cos(eps)   sin(eps) ]
-	     *		[ 0  - sin(eps)  cos(eps) ]
-	     * 
-	     *		[ cos(dpsi)  - sin(dpsi)  0 ]
-	     * R2 =	[ sin(dpsi)   cos(dpsi)   0 ]
-	     *		[      0           0      1 ]
-	     * 
-	     *		[ 1         0                 0         ]
-	     * R3 =	[ 0  cos(eps + deps)  - sin(eps + deps) ]
-	     *		[ 0  sin(eps + deps)   cos(eps + deps)  ]
-	     * 
-	     * for efficiency, here is a explicitely:
-	     */
-	    
-	    se = sin(epsilon);
-	    ce = cos(epsilon);
-	    sp = sin(dpsi);
-	    cp = cos(dpsi);
-	    sede = sin(epsilon + deps);
-	    cede = cos(epsilon + deps);
-
-	    a[0][0] = cp;
-	    a[0][1] = -sp*ce;
-	    a[0][2] = -sp*se;
-
-	    a[1][0] = cede*sp;
-	    a[1][1] = cede*cp*ce+sede*se;
-	    a[1][2] = cede*cp*se-sede*ce;
-
-	    a[2][0] = sede*sp;
-	    a[2][1] = sede*cp*ce-cede*se;
-	    a[2][2] = sede*cp*se+cede*ce;
-
+	    nut_matrix(epsilon, deps, dpsi, a);
 	    lastmj = mj;
+	    lastacc = astro_accuracy();
 	}
 
 	sphcart(*ra, *dec, 1.0, &xold, &yold, &zold);
@@ -437,3 +401,55 @@ nut_eq (double mj, double *ra, double *dec)
 	if (*ra < 0.) *ra += 2.*PI;		/* make positive for display */
 }
 
+/* fill a with the rotation from mean to true equator of date given the mean
+ * obliquity eps and the nutation deps and dpsi, all in rads.
+ */
+void
+nut_matrix (double epsilon, double deps, double dpsi, double a[3][3])
+{
+	double se, ce, sp, cp, sede, cede;
+
+	/* the rotation matrix a applies the nutation correction to
+	 * a vector of equatoreal coordinates Xeq to Xeq' by 3 subsequent
+	 * rotations:  R1 - from equatoreal to ecliptic system by
+	 * rotation of angle epsilon about x, R2 - rotate ecliptic
+	 * system by -dpsi about its z, R3 - from ecliptic to equatoreal
+	 * by rotation of angle -(epsilon + deps)
+	 *
+	 *	Xeq' = A * Xeq = R3 * R2 * R1 * Xeq
+	 * 
+	 *		[ 1       0          0    ]
+	 * R1 =	[ 0   cos(eps)   sin(eps) ]
+	 *		[ 0  - sin(eps)  cos(eps) ]
+	 * 
+	 *		[ cos(dpsi)  - sin(dpsi)  0 ]
+	 * R2 =	[ sin(dpsi)   cos(dpsi)   0 ]
+	 *		[      0           0      1 ]
+	 * 
+	 *		[ 1         0                 0         ]
+	 * R3 =	[ 0  cos(eps + deps)  - sin(eps + deps) ]
+	 *		[ 0  sin(eps + deps)   cos(eps + deps)  ]
+	 * 
+	 * for efficiency, here is a explicitely:
+	 */
+	
+	se = sin(epsilon);
+	ce = cos(epsilon);
+	sp = sin(dpsi);
+	cp = cos(dpsi);
+	sede = sin(epsilon + deps);
+	cede = cos(epsilon + deps);
+
+	a[0][0] = cp;
+	a[0][1] = -sp*ce;
+	a[0][2] = -sp*se;
+
+	a[1][0] = cede*sp;
+	a[1][1] = cede*cp*ce+sede*se;
+	a[1][2] = cede*cp*se-sede*ce;
+
+	a[2][0] = sede*sp;
+	a[2][1] = sede*cp*ce-cede*se;
+	a[2][2] = sede*cp*se+cede*ce;
+}
+
@@ -10,7 +10,6 @@
 
 static void pluto_ell (double mj, double *ret);
 static void chap_trans (double mj, double *ret);
-static void planpos (double mj, int obj, double prec, double *ret);
 
 /* coordinate transformation
  * from:
@@ -78,9 +77,12 @@ double *ret)	/* ecliptic coordinates {l,b,r} at equinox of date */
 /* geometric heliocentric position of planet, mean ecliptic of date
  * (not corrected for light-time)
  */
-static void
+void
 planpos (double mj, int obj, double prec, double *ret)
 {
+	if (ephc_get (obj, mj, ret) == 0)
+	    return;
+
 	if (mj >= CHAP_BEGIN && mj <= CHAP_END) {
 	    if (obj >= JUPITER) {		/* prefer Chapront */
 		chap95(mj, obj, prec, ret);
@@ -145,22 +147,28 @@ void
 plans (double mj, PLCode p, double *lpd0, double *psi0, double *rp0,
 double *rho0, double *lam, double *bet, double *dia, double *mag)
 {
-	static double lastmj = -10000;
-	static double lsn, bsn, rsn;	/* geocentric coords of sun */
-	static double xsn, ysn, zsn;	/* cartesian " */
+	static double acc_prec[] = {0.0, 1e-6, 1e-4};	/* by ACC_* */
+	static ASTRO_TLS double lastmj = -10000;
+	static ASTRO_TLS int lastacc;
+	static ASTRO_TLS double lsn, bsn, rsn;	/* geocentric coords of sun */
+	static ASTRO_TLS double xsn, ysn, zsn;	/* cartesian " */
 	double lp, bp, rp;		/* heliocentric coords of planet */
 	double xp, yp, zp, rho;		/* rect. coords and geocentric dist. */
 	double dt;			/* light time */
 	double *vp;			/* vis_elements[p] */
 	double ci, i;			/* sun/earth angle: cos, degrees */
 	int pass;
+	int acc = astro_accuracy();
 
 	/* get sun cartesian; needed only once at mj */
-	if (mj != lastmj) {
+	STAT_COUNT (STAT_PLANS);
+	if (mj != lastmj || acc != lastacc) {
 	    sunpos (mj, &lsn, &rsn, &bsn);
 	    sphcart (lsn, bsn, rsn, &xsn, &ysn, &zsn);
             lastmj = mj;
-        }
+	    lastacc = acc;
+        } else
+	    STAT_COUNT (STAT_PLANS_HIT);
 
 	/* first find the true position of the planet at mj.
 	 * then repeat a second time for a slightly different time based
@@ -175,7 +183,7 @@ double *rho0, double *lam, double *bet, double *dia, double *mag)
 	     * retarded for light time in second pass;
 	     * alternative option:  vsop allows calculating rates.
 	     */
-	    planpos(mj - dt, p, 0.0, ret);
+	    planpos(mj - dt, p, acc_prec[acc], ret);
 
 	    lp = ret[0];
 	    bp = ret[1];
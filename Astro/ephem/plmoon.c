@@ -10,12 +10,12 @@
 /* private cache of planet ephemerides and when they were computed
  * N.B. don't use ones in builtin[] -- they are the user's responsibility.
  */
-static ObjPl plobj[NOBJ];
-static Now plnow[NOBJ];
+static ASTRO_TLS ObjPl plobj[NOBJ];
+static ASTRO_TLS Now plnow[NOBJ];
 
 /* public builtin storage
  */
-static Obj builtin[NBUILTIN];
+static ASTRO_TLS Obj builtin[NBUILTIN];
 
 static char *moondir;
 
@@ -23,6 +23,52 @@ double *ra, double *dec)	/* ra/dec for mjd1 in, for mjd2 out */
 	precess_hiprec (mjd1, mjd2, ra, dec);
 }
 
+/* fill m with the rotation taking J2000 equatoreal coordinates to those of
+ * the mean equator of mj, using the same angles as precess_hiprec(). the
+ * transpose of m goes the other way.
+ */
+void
+precess_matrix (double mj, double m[3][3])
+{
+	double year, T;
+	double zeta_A, z_A, theta_A;
+	double cze, sze, cz, sz, cth, sth;
+
+	mjd_year (mj, &year);
+	if (fabs (year - 2000.0) <= .02) {
+	    /* precess_hiprec() leaves these untouched too */
+	    m[0][0] = 1; m[0][1] = 0; m[0][2] = 0;
+	    m[1][0] = 0; m[1][1] = 1; m[1][2] = 0;
+	    m[2][0] = 0; m[2][1] = 0; m[2][2] = 1;
+	    return;
+	}
+
+	T = (year - 2000.0)/100.0;
+	zeta_A  = 0.6406161* T + 0.0000839* T*T + 0.0000050* T*T*T;
+	z_A     = 0.6406161* T + 0.0003041* T*T + 0.0000051* T*T*T;
+	theta_A = 0.5567530* T - 0.0001185* T*T - 0.0000116* T*T*T;
+
+	cze = DCOS(zeta_A);
+	sze = DSIN(zeta_A);
+	cz = DCOS(z_A);
+	sz = DSIN(z_A);
+	cth = DCOS(theta_A);
+	sth = DSIN(theta_A);
+
+	/* m = Rz(z_A) * Ry(-theta_A) * Rz(zeta_A) */
+	m[0][0] =  cz*cth*cze - sz*sze;
+	m[0][1] = -cz*cth*sze - sz*cze;
+	m[0][2] = -cz*sth;
+
+	m[1][0] =  sz*cth*cze + cz*sze;
+	m[1][1] = -sz*cth*sze + cz*cze;
+	m[1][2] = -sz*sth;
+
+	m[2][0] =  sth*cze;
+	m[2][1] = -sth*sze;
+	m[2][2] =  cth;
+}
+
 /*
  * Copyright (c) 1990 by Craig Counterman. All rights reserved.
  *
@@ -39,8 +85,8 @@ precess_hiprec (
 double mjd1, double mjd2,	/* initial and final epoch modified JDs */
 double *ra, double *dec)	/* ra/dec for mjd1 in, for mjd2 out */
 {
-	static double last_mjd1 = -213.432, last_from;
-	static double last_mjd2 = -213.432, last_to;
+	static ASTRO_TLS double last_mjd1 = -213.432, last_from;
+	static ASTRO_TLS double last_mjd2 = -213.432, last_to;
 	double zeta_A, z_A, theta_A;
 	double T;
 	double A, B, C;
@@ -52,6 +98,9 @@ double *ra, double *dec)	/* ra/dec for mjd1 in, for mjd2 out */
 	/* convert mjds to years;
 	 * avoid the remarkably expensive calls to mjd_year()
 	 */
+	STAT_COUNT (STAT_PRECESS);
+	if (last_mjd1 == mjd1 && last_mjd2 == mjd2)
+	    STAT_COUNT (STAT_PRECESS_HIT);
 	if (last_mjd1 == mjd1)
 	    from_equinox = last_from;
 	else {
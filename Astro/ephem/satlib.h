@@ -193,11 +193,31 @@ typedef struct _SatData {
 	struct sdp4_data *sdp4;
     } prop;
     struct deep_data *deep;
+    int init;		/* prop/deep hold initialised state. until then the
+			 * propagators fill them in, allocating whichever of
+			 * them is still NULL */
 } SatData;
 
+/* one element set together with storage for its propagator state, so that
+ * it can be initialised once and propagated to any number of times without
+ * touching the heap. see sat_prop_init() and sat_prop().
+ */
+typedef struct _SatProp {
+    SatElem elem;
+    union {
+	struct sgp4_data sgp4;
+	struct sdp4_data sdp4;
+    } prop;
+    struct deep_data deep;
+} SatProp;
+
 void sgp4(SatData *sat, Vec3 *pos, Vec3 *dpos, double t);
 
 void sdp4(SatData *sat, Vec3 *pos, Vec3 *dpos, double TSINCE);
 
+void sat_prop_init(SatProp *sp, const SatElem *se);
+
+void sat_prop(const SatProp *sp, Vec3 *pos, Vec3 *dpos, double TSINCE);
+
 #endif /* __SATLIB_H */
 
@@ -18,8 +18,8 @@ static void moonPShad (Obj *eop, Obj *sop, MoonData md[S_NMOONS]);
 static void moonTrans (MoonData md[S_NMOONS]);
 
 /* moon table and a few other goodies and when it was last computed */
-static double mdmjd = -123456;
-static MoonData smd[S_NMOONS] = {
+static ASTRO_TLS double mdmjd = -123456;
+static ASTRO_TLS MoonData smd[S_NMOONS] = {
     {"Saturn",	NULL},
     {"Mimas",	"I"},
     {"Enceladus","II"},
@@ -30,9 +30,9 @@ static MoonData smd[S_NMOONS] = {
     {"Hyperion","VII"},
     {"Iapetus",	"VIII"},
 };
-static double sizemjd;
-static double etiltmjd;
-static double stiltmjd;
+static ASTRO_TLS double sizemjd;
+static ASTRO_TLS double etiltmjd;
+static ASTRO_TLS double stiltmjd;
 
 /* These values are from the Explanatory Supplement.
  * Precession degrades them gradually over time.
@@ -134,16 +134,9 @@ MoonData md[S_NMOONS])	/* fill md[1..NM-1].x/y/z for each moon */
         BDL_Dataset *dataset;
 	int i;
 
-	/* check ranges and appropriate data file */
-	if (JD < 2451179.50000)		/* Jan 1 1999 UTC */
-	    return (-1);
-	if (JD < 2455562.5)		/* Jan 1 2011 UTC */
-            dataset = & saturne_9910;
-	else if (JD < 2459215.5)	/* Jan 1 2021 UTC */
-            dataset = & saturne_1020;
-        else if (JD < 2466520.5)        /* Jan 1 2041 UTC */
-            dataset = & saturne_2040;
-	else
+	/* find the appropriate data set */
+	dataset = bdl_dataset (SATURN, JD);
+	if (!dataset)
 	    return (-1);
 
 	/* use it */
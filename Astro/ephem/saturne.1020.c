@@ -4705,5 +4705,6 @@ BDL_Dataset saturne_1020 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
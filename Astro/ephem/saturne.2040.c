@@ -9637,5 +9637,6 @@ BDL_Dataset saturne_2040 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
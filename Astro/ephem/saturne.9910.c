@@ -5092,5 +5092,6 @@ BDL_Dataset saturne_9910 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
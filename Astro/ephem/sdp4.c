@@ -123,7 +123,7 @@ sdp4 (SatData *sat, Vec3 *pos, Vec3 *dpos, double TSINCE)
      XMAM=XMDF=XMX=XMY=XN=XNODDF=XNODE=XNODEK = signaling_nan();
 #endif
 
-    if(TSINCE != 0.0 && !sat->prop.sdp4) {
+    if(TSINCE != 0.0 && !sat->init) {
 	/*
 	 * Yes, this is a recursive call.
 	 */
@@ -132,8 +132,9 @@ sdp4 (SatData *sat, Vec3 *pos, Vec3 *dpos, double TSINCE)
 
 /*      IF  (IFLAG .EQ. 0) GO TO 100 */
 /*    if(!IFLAG) */
-    if(!sat->prop.sdp4) {
-	sat->prop.sdp4 = (struct sdp4_data *) malloc(sizeof(struct sdp4_data));
+    if(!sat->init) {
+	if(!sat->prop.sdp4)
+	    sat->prop.sdp4 = (struct sdp4_data *) malloc(sizeof(struct sdp4_data));
 
 /*	init_sdp4(sat->prop.sdp4); */
 
@@ -228,6 +229,7 @@ sdp4 (SatData *sat, Vec3 *pos, Vec3 *dpos, double TSINCE)
 #endif
 	dpinit(sat, EOSQ, SINIO, COSIO, BETAO, AODP, THETA2,
 	       SING, COSG, BETAO2, XMDOT, OMGDOT, XNODOT, XNODP);
+	sat->init = 1;
 
 /*      CALL DPINIT(EOSQ,SINIO,COSIO,BETAO,AODP,THETA2,
 	1         SING,COSG,BETAO2,XMDOT,OMGDOT,XNODOT,XNODP) */
@@ -110,8 +110,9 @@ sgp4(SatData *sat, Vec3 *pos, Vec3 *dpos, double TSINCE)
 	XMY = XN = XNODDF = XNODE = XNODEK = signaling_nan();
 #endif
 
-    if(!sat->prop.sgp4) {
-	sat->prop.sgp4 = (struct sgp4_data *) malloc(sizeof(struct sgp4_data));
+    if(!sat->init) {
+	if(!sat->prop.sgp4)
+	    sat->prop.sgp4 = (struct sgp4_data *) malloc(sizeof(struct sgp4_data));
 
 	/*
 	 * RECOVER ORIGINAL MEAN MOTION (XNODP) AND SEMIMAJOR AXIS (AODP)
@@ -252,6 +253,7 @@ sgp4(SatData *sat, Vec3 *pos, Vec3 *dpos, double TSINCE)
 			  6.0 * D2 * D2 +
 			  15.0 * C1SQ * (2.0 * D2 + C1SQ));
 	}
+	sat->init = 1;
     }
 
     /*
@@ -0,0 +1,334 @@
+/* counters of the calls that cost time, and log2 histograms of how long the
+ * public entry points take, for finding out why a request was slow.
+ *
+ * each thread counts into its own block, linked into a list so a snapshot
+ * can add them all up; a thread's block is folded into the retired totals
+ * when it exits. nothing is locked on the counting side: counts are bumped
+ * and read with relaxed atomics, so a snapshot taken while others are
+ * computing sees whole counts, but only as of roughly that moment.
+ * stats_reset() records the totals so far and later snapshots count from
+ * them; no thread's counters are written by another.
+ *
+ * all this only when built with ASTRO_STATS defined; otherwise STAT_COUNT()
+ * and the timers in astro_common.cpp compile to nothing and snapshots are
+ * all zero.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "astro.h"
+
+#ifdef ASTRO_STATS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+/* one more, and a read, of a counter another thread may be reading. only
+ * its own thread bumps it, so a whole load and store will do and no locked
+ * add is needed; relaxed, as no count orders anything else. 64 bit
+ * volatiles are whole on 64 bit Windows; 32 bit has to interlock.
+ */
+#ifdef _WIN32
+#ifdef _WIN64
+#define	stats_inc(p)	(*(volatile LONG64 *)(p) = *(volatile LONG64 *)(p) + 1)
+#else
+#define	stats_inc(p)	InterlockedIncrement64 ((volatile LONG64 *)(p))
+#endif
+#define	stats_load(p)	((unsigned long long) \
+			    InterlockedCompareExchange64 ((volatile LONG64 *)(p), 0, 0))
+#else
+#define	stats_inc(p)	__atomic_store_n ((p), \
+			    __atomic_load_n ((p), __ATOMIC_RELAXED) + 1, \
+			    __ATOMIC_RELAXED)
+#define	stats_load(p)	__atomic_load_n ((p), __ATOMIC_RELAXED)
+#endif
+#endif
+
+static const char *count_names[NSTATCOUNTS] = {
+    "obj_cir",
+    "obj_earthsat",
+    "vsop87",
+    "moon",
+    "nutation", "nutation_hit",
+    "deltat", "deltat_hit",
+    "plans", "plans_hit",
+    "precess", "precess_hit",
+};
+
+static const char *timer_names[NSTATTIMERS] = {
+    "GetModifiedRiset",
+    "FindAltXSun",
+    "FindMoonPhase",
+    "GetMoonPhaseEvents",
+    "GetRADECRiset",
+    "GetStarRisets",
+    "TransformStars",
+    "GetSkyPositions",
+    "GetSatellitePosition",
+    "GetSatelliteStatus",
+    "GetNextSatellitePass",
+    "GetSatellitePasses",
+    "GetSunDetails",
+    "WarmEphemerisCache",
+    "GetAlmanac",
+    "GetSitePositions",
+    "GetSiteRisets",
+};
+
+/* name of counter s, or NULL */
+const char *
+stats_count_name (int s)
+{
+	return (s >= 0 && s < NSTATCOUNTS ? count_names[s] : NULL);
+}
+
+/* name of the entry point timer t times, or NULL */
+const char *
+stats_timer_name (int t)
+{
+	return (t >= 0 && t < NSTATTIMERS ? timer_names[t] : NULL);
+}
+
+#ifdef ASTRO_STATS
+
+typedef struct _StatBlock {
+	AstroStats sb_stats;
+	struct _StatBlock *sb_next;
+} StatBlock;
+
+static StatBlock *blocks;		/* one per live thread that counted */
+static AstroStats retired;		/* from threads since exited */
+static AstroStats base;			/* totals at the last stats_reset() */
+static ASTRO_TLS StatBlock *mine;
+
+/* add the counts of b, which its thread may be bumping, into a */
+static void
+stats_add (AstroStats *a, const AstroStats *b)
+{
+	int i, j;
+
+	for (i = 0; i < NSTATCOUNTS; i++)
+	    a->st_count[i] += stats_load (&b->st_count[i]);
+	for (i = 0; i < NSTATTIMERS; i++)
+	    for (j = 0; j < STAT_NBUCKETS; j++)
+		a->st_hist[i][j] += stats_load (&b->st_hist[i][j]);
+}
+
+/* unlink block, which thread exit hands us, and keep its counts */
+static void stats_retire (void *block);
+
+#ifdef _WIN32
+static SRWLOCK stats_lock = SRWLOCK_INIT;
+static INIT_ONCE stats_once = INIT_ONCE_STATIC_INIT;
+static DWORD stats_key;
+
+#define	stats_lockit()		AcquireSRWLockExclusive (&stats_lock)
+#define	stats_unlockit()	ReleaseSRWLockExclusive (&stats_lock)
+
+static VOID NTAPI
+stats_fls_cb (PVOID block)
+{
+	if (block)
+	    stats_retire (block);
+}
+
+static BOOL CALLBACK
+stats_once_cb (PINIT_ONCE once, PVOID param, PVOID *ctx)
+{
+	stats_key = FlsAlloc (stats_fls_cb);
+	return (TRUE);
+}
+
+static void
+stats_key_set (StatBlock *bp)
+{
+	InitOnceExecuteOnce (&stats_once, stats_once_cb, NULL, NULL);
+	FlsSetValue (stats_key, bp);
+}
+#else
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+
+#define	stats_lockit()		pthread_mutex_lock (&stats_lock)
+#define	stats_unlockit()	pthread_mutex_unlock (&stats_lock)
+
+static void
+stats_key_make (void)
+{
+	pthread_key_create (&stats_key, stats_retire);
+}
+
+static void
+stats_key_set (StatBlock *bp)
+{
+	pthread_once (&stats_once, stats_key_make);
+	pthread_setspecific (stats_key, bp);
+}
+#endif
+
+static void
+stats_retire (void *block)
+{
+	StatBlock *bp = (StatBlock *)block, **bpp;
+
+	stats_lockit();
+	for (bpp = &blocks; *bpp; bpp = &(*bpp)->sb_next)
+	    if (*bpp == bp) {
+		*bpp = bp->sb_next;
+		break;
+	    }
+	stats_add (&retired, &bp->sb_stats);
+	stats_unlockit();
+	free (bp);
+	mine = NULL;
+}
+
+/* this thread's block, made on first use. NULL if there is no memory */
+static StatBlock *
+stats_mine (void)
+{
+	StatBlock *bp;
+
+	if (mine)
+	    return (mine);
+	bp = (StatBlock *) calloc (1, sizeof(StatBlock));
+	if (!bp)
+	    return (NULL);
+	stats_lockit();
+	bp->sb_next = blocks;
+	blocks = bp;
+	stats_unlockit();
+	stats_key_set (bp);
+	return (mine = bp);
+}
+
+int
+stats_enabled (void)
+{
+	return (1);
+}
+
+/* count one more of s in this thread */
+void
+stats_count (int s)
+{
+	StatBlock *bp = stats_mine();
+
+	if (bp)
+	    stats_inc (&bp->sb_stats.st_count[s]);
+}
+
+/* a monotonic clock, ns */
+unsigned long long
+stats_clock (void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+
+	if (!freq.QuadPart)
+	    QueryPerformanceFrequency (&freq);
+	QueryPerformanceCounter (&now);
+	return ((unsigned long long)(now.QuadPart * (1e9 / freq.QuadPart)));
+#else
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ((unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+/* add a call to timer t that took ns */
+void
+stats_time (int t, unsigned long long ns)
+{
+	StatBlock *bp = stats_mine();
+	int i;
+
+	if (!bp)
+	    return;
+	for (i = 0; ns > 1 && i < STAT_NBUCKETS-1; i++)
+	    ns >>= 1;
+	stats_inc (&bp->sb_stats.st_hist[t][i]);
+}
+
+/* sum of every thread's counts, ever */
+static void
+stats_total (AstroStats *sp)
+{
+	StatBlock *bp;
+
+	*sp = retired;
+	for (bp = blocks; bp; bp = bp->sb_next)
+	    stats_add (sp, &bp->sb_stats);
+}
+
+/* fill *sp with the counts of all threads since the last stats_reset() */
+void
+stats_snapshot (AstroStats *sp)
+{
+	int i, j;
+
+	stats_lockit();
+	stats_total (sp);
+	for (i = 0; i < NSTATCOUNTS; i++)
+	    sp->st_count[i] -= base.st_count[i];
+	for (i = 0; i < NSTATTIMERS; i++)
+	    for (j = 0; j < STAT_NBUCKETS; j++)
+		sp->st_hist[i][j] -= base.st_hist[i][j];
+	stats_unlockit();
+}
+
+/* count from zero again */
+void
+stats_reset (void)
+{
+	stats_lockit();
+	stats_total (&base);
+	stats_unlockit();
+}
+
+#else /* !ASTRO_STATS */
+
+int
+stats_enabled (void)
+{
+	return (0);
+}
+
+void
+stats_count (int s)
+{
+	(void)s;
+}
+
+unsigned long long
+stats_clock (void)
+{
+	return (0);
+}
+
+void
+stats_time (int t, unsigned long long ns)
+{
+	(void)t;
+	(void)ns;
+}
+
+void
+stats_snapshot (AstroStats *sp)
+{
+	memset (sp, 0, sizeof(*sp));
+}
+
+void
+stats_reset (void)
+{
+}
+
+#endif /* ASTRO_STATS */
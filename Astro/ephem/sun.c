@@ -17,17 +17,21 @@
 void
 sunpos (double mj, double *lsn, double *rsn, double *bsn)
 {
-	static double last_mj = -3691, last_lsn, last_rsn, last_bsn;
+	static double acc_prec[] = {0.0, 1e-6, 1e-4};	/* by ACC_* */
+	static ASTRO_TLS double last_mj = -3691, last_lsn, last_rsn, last_bsn;
+	static ASTRO_TLS int last_acc;
+	int acc = astro_accuracy();
 	double ret[6];
 
-	if (mj == last_mj) {
+	if (mj == last_mj && acc == last_acc) {
 	    *lsn = last_lsn;
 	    *rsn = last_rsn;
 	    if (bsn) *bsn = last_bsn;
 	    return;
 	}
 
-	vsop87(mj, SUN, 0.0, ret);	/* full precision earth pos */
+	if (ephc_get(SUN, mj, ret) < 0)
+	    vsop87(mj, SUN, acc_prec[acc], ret);	/* earth pos */
 
 	*lsn = ret[0] - PI;		/* revert to sun pos */
 	range (lsn, 2*PI);		/* normalise */
@@ -36,6 +40,7 @@ sunpos (double mj, double *lsn, double *rsn, double *bsn)
 	last_rsn = *rsn = ret[2];
 	last_bsn = -ret[1];
 	last_mj = mj;
+	last_acc = acc;
 
 	if (bsn) *bsn = last_bsn;	/* assign only if non-NULL pointer */
 }
@@ -0,0 +1,91 @@
+/* quantities that depend only on the instant and so may be shared by every
+ * object reduced at that instant.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "astro.h"
+
+/* fill tc with everything obj_cir_ctx() needs that depends only on np's
+ * instant: TT, obliquity, nutation, the sun and sidereal time at greenwich,
+ * at this thread's astro_accuracy().
+ * N.B. unlike now_lst(), the equation of the equinoxes uses nutation at TT
+ *   rather than UT; the difference is well under a micro arc second.
+ */
+void
+time_ctx (Now *np, TimeCtx *tc)
+{
+	double gst;
+
+	tc->tc_mjd = mjd;
+	tc->tc_mjed = mjed;
+	tc->tc_acc = astro_accuracy();
+
+	obliquity (tc->tc_mjed, &tc->tc_eps);
+	nutation (tc->tc_mjed, &tc->tc_deps, &tc->tc_dpsi);
+	sunpos (tc->tc_mjed, &tc->tc_lsn, &tc->tc_rsn, &tc->tc_bsn);
+
+	utc_gst (mjd_day(mjd), mjd_hr(mjd), &gst);
+	gst += radhr(tc->tc_dpsi*cos(tc->tc_eps+tc->tc_deps));
+	range (&gst, 24.0);
+	tc->tc_gast = gst;
+
+	nut_matrix (tc->tc_eps, tc->tc_deps, tc->tc_dpsi, tc->tc_nut);
+	precess_matrix (tc->tc_mjed, tc->tc_prec);
+}
+
+/* apply m, or its transpose if inv, to the direction ra/dec IN PLACE */
+static void
+tc_rotate (const double m[3][3], int inv, double *ra, double *dec)
+{
+	double x0, y0, z0, x, y, z;
+
+	sphcart (*ra, *dec, 1.0, &x0, &y0, &z0);
+	if (inv) {
+	    x = m[0][0] * x0 + m[1][0] * y0 + m[2][0] * z0;
+	    y = m[0][1] * x0 + m[1][1] * y0 + m[2][1] * z0;
+	    z = m[0][2] * x0 + m[1][2] * y0 + m[2][2] * z0;
+	} else {
+	    x = m[0][0] * x0 + m[0][1] * y0 + m[0][2] * z0;
+	    y = m[1][0] * x0 + m[1][1] * y0 + m[1][2] * z0;
+	    z = m[2][0] * x0 + m[2][1] * y0 + m[2][2] * z0;
+	}
+	cartsph (x, y, z, ra, dec, &z0);	/* radius should be 1.0 */
+}
+
+/* same as nut_eq(tc->tc_mjed, ra, dec) */
+void
+tc_nut_eq (const TimeCtx *tc, double *ra, double *dec)
+{
+	tc_rotate (tc->tc_nut, 0, ra, dec);
+	if (*ra < 0.) *ra += 2.*PI;		/* make positive for display */
+}
+
+/* same as precess(mjd1, mjd2, ra, dec) but uses tc's matrix when going
+ * between J2000 and tc's TT.
+ */
+void
+tc_precess (const TimeCtx *tc, double mjd1, double mjd2, double *ra,
+double *dec)
+{
+	if (mjd1 == J2000 && mjd2 == tc->tc_mjed)
+	    tc_rotate (tc->tc_prec, 0, ra, dec);
+	else if (mjd1 == tc->tc_mjed && mjd2 == J2000)
+	    tc_rotate (tc->tc_prec, 1, ra, dec);
+	else {
+	    precess (mjd1, mjd2, ra, dec);
+	    return;
+	}
+	range (ra, 2.0*PI);
+}
+
+/* same as now_lst(np, lstp), using tc's sidereal time at greenwich */
+void
+tc_lst (const TimeCtx *tc, Now *np, double *lstp)
+{
+	double lst = tc->tc_gast + radhr(lng);
+
+	range (&lst, 24.0);
+	*lstp = lst;
+}
@@ -17,8 +17,8 @@ static void moonPShad (Obj *sop, Obj *uop, MoonData md[U_NMOONS]);
 static void moonTrans (MoonData md[U_NMOONS]);
 
 /* moon table and a few other goodies and when it was last computed */
-static double mdmjd = -123456;
-static MoonData umd[U_NMOONS] = {
+static ASTRO_TLS double mdmjd = -123456;
+static ASTRO_TLS MoonData umd[U_NMOONS] = {
     {"Uranus", NULL},
     {"Ariel", "I"},
     {"Umbriel", "II"},
@@ -26,7 +26,7 @@ static MoonData umd[U_NMOONS] = {
     {"Oberon", "IV"},
     {"Miranda", "V"},
 };
-static double sizemjd;	/* size at last mjd */
+static ASTRO_TLS double sizemjd;	/* size at last mjd */
 
 /* These values are from the Explanatory Supplement.
  * Precession degrades them gradually over time.
@@ -125,16 +125,9 @@ MoonData md[U_NMOONS])	/* fill md[1..NM-1].x/y/z for each moon */
         BDL_Dataset *dataset;
 	int i;
 
-	/* check ranges and appropriate data file */
-	if (JD < 2451179.50000)		/* Jan 1 1999 UTC */
-	    return (-1);
-	if (JD < 2455562.5)		/* Jan 1 2011 UTC */
-            dataset = & uranus_9910;
-	else if (JD < 2459215.5)	/* Jan 1 2021 UTC */
-            dataset = & uranus_1020;
-        else if (JD < 2466520.5)        /* Jan 1 2041 UTC */
-            dataset = & uranus_2040;
-	else
+	/* find the appropriate data set */
+	dataset = bdl_dataset (URANUS, JD);
+	if (!dataset)
 	    return (-1);
 
 	/* use it */
@@ -1555,5 +1555,6 @@ BDL_Dataset uranus_1020 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
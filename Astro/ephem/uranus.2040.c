@@ -2788,5 +2788,6 @@ BDL_Dataset uranus_2040 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
@@ -1699,5 +1699,6 @@ BDL_Dataset uranus_9910 = {
      idn_list,
      freq_list,
      delt_list,
-     moonrecords
+     moonrecords,
+     sizeof(moonrecords)/sizeof(moonrecords[0])
 };
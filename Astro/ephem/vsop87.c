@@ -33,6 +33,7 @@
  *	1e-3	139	1.0	0.9
  */
 
+#include <float.h>
 #include <math.h>
 
 #include "astro.h"
@@ -40,6 +41,63 @@
 
 #define VSOP_A1000	365250.0	/* days per millenium */
 #define VSOP_MAXALPHA	5		/* max degree of time */
+#define VSOP_BLOCK	8		/* terms summed per pass, see vsop_cos() */
+#define VSOP_MAXARG	1.5e6		/* largest argument for vsop_cos() */
+#define VSOP_RND	6755399441055744.0	/* 1.5 * 2^52, see vsop_cos() */
+
+/* vsop_cos() only where doubles are evaluated as written; otherwise libm */
+#if defined(__FAST_MATH__) || defined(_M_FP_FAST) || FLT_EVAL_METHOD != 0
+#define VSOP_BLOCKCOS	0
+#else
+#define VSOP_BLOCKCOS	1
+#endif
+
+/* cos() of a block of arguments, |x[i]| < VSOP_MAXARG.
+ * no calls, branches or integer conversions, so compilers turn the loop
+ * into SSE2, AVX2 or NEON code as the target allows: Cody-Waite reduction
+ * by PI/2, exact for the quadrants of such arguments, then the fdlibm
+ * sin/cos kernels. accurate to about 1e-16.
+ * (x + VSOP_RND) - VSOP_RND rounds x to an integer only when every step is
+ * evaluated in IEEE double; -ffast-math, which may fold it to x, or x87
+ * extended precision break it, so such builds leave it out, see
+ * VSOP_BLOCKCOS.
+ */
+#if VSOP_BLOCKCOS
+static void
+vsop_cos (const double x[VSOP_BLOCK], double y[VSOP_BLOCK])
+{
+    static const double pio2_1 = 1.57079632673412561417e+00;
+    static const double pio2_2 = 6.07710050630396597660e-11;
+    static const double pio2_3 = 2.02226624871116645580e-21;
+    int i;
+
+    for (i = 0; i < VSOP_BLOCK; ++i) {
+	double k, m, h, odd, neg, r, z, s, c;
+
+	/* quadrant k, and from k mod 4 whether to use sin and to negate,
+	 * each as exact 0 or 1 so the choice needs no branch.
+	 */
+	k = (x[i] * (2/PI) + VSOP_RND) - VSOP_RND;
+	m = k - 4*((k*0.25 - 0.375 + VSOP_RND) - VSOP_RND);
+	h = (m*0.5 - 0.25 + VSOP_RND) - VSOP_RND;
+	odd = m - 2*h;
+	neg = (h - odd)*(h - odd);
+
+	r = ((x[i] - k*pio2_1) - k*pio2_2) - k*pio2_3;
+	z = r*r;
+
+	s = r + r*z*(-1.66666666666666324348e-01 + z*(8.33333333332248946124e-03
+		+ z*(-1.98412698298579493134e-04 + z*(2.75573137070700676789e-06
+		+ z*(-2.50507602534068634195e-08 + z*1.58969099521155010221e-10)))));
+	c = 1 - 0.5*z + z*z*(4.16666666666666019037e-02
+		+ z*(-1.38888888888741095749e-03 + z*(2.48015872894767294178e-05
+		+ z*(-2.75573143513906633035e-07 + z*(2.08757232129817482790e-09
+		+ z*-1.13596475577881948265e-11)))));
+
+	y[i] = ((1 - odd)*c + odd*s) * (1 - 2*neg);
+    }
+}
+#endif /* VSOP_BLOCKCOS */
 
 /******************************************************************
  * adapted from BdL FORTRAN Code; stern
@@ -118,6 +176,7 @@ vsop87 (double mj, int obj, double prec, double *ret)
     double q;					/* aux for precision control */
     int i, cooidx, alpha;			/* misc indexes */
 
+    STAT_COUNT (STAT_VSOP87);
     if (obj == PLUTO || obj > SUN)
 	return (2);
 
@@ -154,19 +213,43 @@ vsop87 (double mj, int obj, double prec, double *ret)
 		p *= a0[obj];
 
 	    term = termdot = 0.0;
-	    for (i = vn_obj[alpha][cooidx]; i < vn_obj[alpha+1][cooidx]; ++i) {
-		double a, b, c, arg;
+	    for (i = vn_obj[alpha][cooidx]; i < vn_obj[alpha+1][cooidx]; ) {
+		double amp[VSOP_BLOCK], arg[VSOP_BLOCK], cs[VSOP_BLOCK];
+		double rate[VSOP_BLOCK];
+		double big = 0.0;
+		int n, k;
 
-		a = vx_obj[i][0];
-		if (a < p) continue;	/* ignore small terms */
+		/* gather the next terms not too small into a block, so those
+		 * left out cost nothing; pad past the last with zero amplitude.
+		 */
+		for (n = 0; n < VSOP_BLOCK && i < vn_obj[alpha+1][cooidx]; ++i) {
+		    if (vx_obj[i][0] < p)	/* ignore small terms */
+			continue;
+		    amp[n] = vx_obj[i][0];
+		    arg[n] = vx_obj[i][1] + vx_obj[i][2] * t[1];
+		    rate[n] = vx_obj[i][2];
+		    if (fabs(arg[n]) > big)
+			big = fabs(arg[n]);
+		    ++n;
+		}
+		if (n == 0)
+		    break;
+		for (k = n; k < VSOP_BLOCK; ++k)
+		    amp[k] = arg[k] = rate[k] = 0.0;
 
-		b = vx_obj[i][1];
-		c = vx_obj[i][2];
+#if VSOP_BLOCKCOS
+		if (big < VSOP_MAXARG)
+		    vsop_cos (arg, cs);
+		else
+#endif
+		    for (k = 0; k < VSOP_BLOCK; ++k)
+			cs[k] = cos(arg[k]);
 
-		arg = b + c * t[1];
-		term += a * cos(arg);
+		for (k = 0; k < VSOP_BLOCK; ++k)
+		    term += amp[k] * cs[k];
 #if VSOP_GETRATE
-		termdot += -c * a * sin(arg);
+		for (k = 0; k < VSOP_BLOCK; ++k)
+		    termdot += -rate[k] * amp[k] * sin(arg[k]);
 #endif
 	    }
 
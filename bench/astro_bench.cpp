@@ -0,0 +1,406 @@
+//
+// Benchmarks of the astro_common entry points, for comparing builds.
+//
+// Not part of the Swift package or the Xcode project; on Linux build it
+// against the library sources, with the linker wraps below, by
+//
+//   make -C bench
+//
+// and run bench/astro_bench [--json] [--filter text] [--scale factor]
+// [--accuracy tier], tier an ACC_* of astro.h. Inputs are fixed, so two
+// builds run the same calls; every benchmark moves its time on by an odd
+// step each call so no per-instant cache answers it.
+// evals/op counts the top level obj_cir(), obj_cir_ctx() and obj_earthsat()
+// calls through the linker wraps, those made inside circum.c not included.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "astro_common.h"
+
+using namespace std;
+
+/* ephemeris evaluations, see the linker wraps above, from any thread */
+static atomic<long> evaluations;
+static thread_local int evaluating;
+
+extern "C" {
+int __real_obj_cir(Now *np, Obj *op);
+int __real_obj_cir_ctx(Now *np, const TimeCtx *tc, Obj *op);
+int __real_obj_earthsat(Now *np, Obj *op);
+
+int __wrap_obj_cir(Now *np, Obj *op)
+{
+    if (!evaluating++)
+        evaluations++;
+    int result = __real_obj_cir(np, op);
+    evaluating--;
+    return result;
+}
+
+int __wrap_obj_cir_ctx(Now *np, const TimeCtx *tc, Obj *op)
+{
+    if (!evaluating++)
+        evaluations++;
+    int result = __real_obj_cir_ctx(np, tc, op);
+    evaluating--;
+    return result;
+}
+
+int __wrap_obj_earthsat(Now *np, Obj *op)
+{
+    if (!evaluating++)
+        evaluations++;
+    int result = __real_obj_earthsat(np, op);
+    evaluating--;
+    return result;
+}
+}
+
+/* Greenwich at the March equinox of 2024 */
+#define BENCH_LONGITUDE     -0.0015
+#define BENCH_LATITUDE      51.4779
+#define BENCH_ALTITUDE      46.0
+#define BENCH_TIME          1710892800.0
+
+/* TLEs with epochs at BENCH_TIME */
+static const char *leo[3] = {
+    "ISS (ZARYA)",
+    "1 25544U 98067A   24080.00000000  .00016717  00000-0  30000-3 0  9992",
+    "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.49815628442345",
+};
+static const char *geo[3] = {
+    "GOES 16",
+    "1 41866U 16071A   24080.00000000 -.00000245  00000-0  00000+0 0  9995",
+    "2 41866   0.0152 257.3282 0000684 258.5520 218.2147  1.00271564275194",
+};
+
+static const char *bodyNames[NOBJ] = {
+    "mercury", "venus", "mars", "jupiter", "saturn", "uranus", "neptune", "pluto", "sun", "moon",
+};
+
+/* one call of a benchmark, the i-th of the run */
+typedef void (*BenchCall)(int body, int i);
+
+struct Benchmark {
+    string name;
+    BenchCall call;
+    int body;           /* PLCode, for those that take one */
+    int iterations;     /* at --scale 1 */
+};
+
+struct BenchResult {
+    string name;
+    int iterations;
+    double nsPerOp;
+    double evalsPerOp;
+};
+
+/* sink for results, so no call is optimised away */
+static volatile double sink;
+
+static void BenchObjCir(int body, int i)
+{
+    Now now;
+    Obj *objs;
+    getBuiltInObjs(&objs);
+    ConfigureObserver(BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE, BENCH_TIME + i * 3607.0, &now);
+
+    Obj obj = objs[body];
+    obj_cir(&now, &obj);
+    sink = obj.any.co_alt;
+}
+
+static void BenchModifiedRiset(int body, int i)
+{
+    Now now;
+    RiseSet riset;
+    double el, az;
+    ConfigureObserver(BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE, BENCH_TIME + i * 86407.0, &now);
+    GetModifiedRiset(&now, body, &riset, &el, &az, true);
+    sink = riset.rs_settm;
+}
+
+static void BenchFindAltXSun(int, int i)
+{
+    Now now;
+    double jd = 0;
+    ConfigureObserver(BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE, BENCH_TIME + i * 86407.0, &now);
+    FindAltXSun(&now, 1.0 / 1440, 2, 1, 1, &jd, radian(-6));
+    sink = jd;
+}
+
+static void BenchSunDetails(int days, int i)
+{
+    double start = BENCH_TIME + i * 86407.0;
+    auto periods = GetSunDetails(BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE, start, start + days * 86400.0);
+    sink = periods.size();
+}
+
+static void BenchAlmanac(int days, int i)
+{
+    auto almanac = GetAlmanac(BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE, BENCH_TIME + i * 86407.0, days);
+    sink = almanac.back().sunSet;
+}
+
+/* a 100 by 50 degree map of sites around Greenwich, 1 by 0.5 degrees apart */
+#define BENCH_SITES     10000
+
+static const SiteGrid *BenchSites()
+{
+    static vector<double> longitude, latitude, altitude;
+    static SiteGrid grid;
+    if (longitude.empty())
+    {
+        for (int k = 0; k < BENCH_SITES; k++)
+        {
+            longitude.push_back(BENCH_LONGITUDE - 50 + k % 100);
+            latitude.push_back(BENCH_LATITUDE - 25 + k / 100 * 0.5);
+            altitude.push_back(BENCH_ALTITUDE);
+        }
+        grid = {longitude.data(), latitude.data(), altitude.data(), BENCH_SITES};
+    }
+    return &grid;
+}
+
+static void BenchSitePositions(int body, int i)
+{
+    static vector<double> alt(BENCH_SITES), az(BENCH_SITES);
+    SkyPositions positions = {};
+    positions.alt = alt.data();
+    positions.az = az.data();
+    GetSitePositions(body, BENCH_TIME + i * 3607.0, BenchSites(), &positions);
+    sink = alt[0];
+}
+
+static void BenchSiteRisets(int body, int i)
+{
+    static vector<double> rise(BENCH_SITES), set(BENCH_SITES);
+    double start = BENCH_TIME + i * 86407.0;
+    GetSiteRisets(body, start, start + 86400, BenchSites(), rise.data(), set.data());
+    sink = set[0];
+}
+
+static void BenchFindMoonPhase(int, int i)
+{
+    sink = FindMoonPhase(BENCH_TIME + i * 86407.0, 2 * M_PI, M_PI);
+}
+
+static void BenchRADECRiset(int, int i)
+{
+    double riseTime, setTime, transitTime, az_r, az_s, az_c, az_t, el_c, el_t;
+    int status;
+    /* Sirius */
+    GetRADECRiset(101.2872, -16.7161, BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_TIME + i * 3607.0,
+                  &riseTime, &setTime, &transitTime, &status, &az_r, &az_s, &az_c, &az_t, &el_c, &el_t);
+    sink = setTime;
+}
+
+/* every body at hours instants an hour apart */
+static void BenchSkyPositions(int hours, int i)
+{
+    vector<double> alt(NOBJ * hours), az(NOBJ * hours);
+    int indices[NOBJ];
+    for (int body = MERCURY; body < NOBJ; body++)
+        indices[body] = body;
+    vector<double> times(hours);
+    for (int t = 0; t < hours; t++)
+        times[t] = BENCH_TIME + i * 86407.0 + t * 3600.0;
+
+    SkyPositions positions = {};
+    positions.alt = alt.data();
+    positions.az = az.data();
+    GetSkyPositions(indices, NOBJ, times.data(), hours, BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE, &positions);
+    sink = alt[0];
+}
+
+/* stars spread over the sky by a fixed sequence, with proper motions of up
+ * to a few hundred milliarcseconds a year */
+#define BENCH_STARS     10000
+
+static const StarCatalog *BenchStars()
+{
+    static vector<double> ra, dec, pmRA, pmDec;
+    static StarCatalog catalog;
+    if (ra.empty())
+    {
+        for (int k = 0; k < BENCH_STARS; k++)
+        {
+            ra.push_back(fmod(k * 137.508, 360));
+            dec.push_back(asin(2 * fmod(k * 0.618034, 1.0) - 1) * 180 / M_PI);
+            pmRA.push_back(fmod(k * 37.0, 600) - 300);
+            pmDec.push_back(fmod(k * 53.0, 600) - 300);
+        }
+        catalog = {ra.data(), dec.data(), pmRA.data(), pmDec.data(), BENCH_STARS};
+    }
+    return &catalog;
+}
+
+static void BenchStarRisets(int, int i)
+{
+    static vector<double> rise(BENCH_STARS), set(BENCH_STARS), transit(BENCH_STARS);
+    StarRisets risets = {};
+    risets.riseTime = rise.data();
+    risets.setTime = set.data();
+    risets.transitTime = transit.data();
+    GetStarRisets(BenchStars(), BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_TIME + i * 3607.0, &risets);
+    sink = set[0];
+}
+
+static void BenchTransformStars(int, int i)
+{
+    static vector<double> alt(BENCH_STARS), az(BENCH_STARS);
+    StarTransform transform;
+    GetStarTransform(BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE, BENCH_TIME + i * 3607.0, &transform);
+    SkyPositions positions = {};
+    positions.alt = alt.data();
+    positions.az = az.data();
+    TransformStars(&transform, BenchStars(), &positions);
+    sink = alt[0];
+}
+
+static void BenchMoonPhaseEvents(int days, int i)
+{
+    double start = BENCH_TIME + i * 86407.0;
+    auto events = GetMoonPhaseEvents(start, start + days * 86400.0);
+    sink = events.size();
+}
+
+static void BenchSatellitePosition(int body, int i)
+{
+    const char **tle = body ? geo : leo;
+    double el, az;
+    GetSatellitePosition(tle[0], tle[1], tle[2], BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE, BENCH_TIME + i * 61.0, &el, &az);
+    sink = el;
+}
+
+static void BenchNextSatellitePass(int body, int i)
+{
+    const char **tle = body ? geo : leo;
+    RiseSet riset, visibleRiset;
+    double visibleRiseAlt, visibleSetAlt;
+    GetNextSatellitePass(tle[0], tle[1], tle[2], BENCH_TIME + i * 3607.0, BENCH_LONGITUDE, BENCH_LATITUDE, BENCH_ALTITUDE,
+                         &riset, &visibleRiset, &visibleRiseAlt, &visibleSetAlt);
+    sink = riset.rs_risetm;
+}
+
+/* the two satellites over a line of observers through Greenwich, 10
+ * degrees of latitude apart, for a day */
+#define BENCH_OBSERVERS 10
+
+static void BenchSatellitePasses(int threads, int i)
+{
+    static const SatelliteHandle *satellites[2] = {
+        CreateSatelliteHandle(leo[0], leo[1], leo[2]),
+        CreateSatelliteHandle(geo[0], geo[1], geo[2]),
+    };
+    SatelliteObserver observers[BENCH_OBSERVERS];
+    for (int k = 0; k < BENCH_OBSERVERS; k++)
+        observers[k] = {BENCH_LONGITUDE, BENCH_LATITUDE - 45 + k * 10.0, BENCH_ALTITUDE};
+
+    double start = BENCH_TIME + i * 3607.0;
+    auto passes = GetSatellitePasses(satellites, 2, observers, BENCH_OBSERVERS, start, start + 86400, threads);
+    sink = passes.size();
+}
+
+static vector<Benchmark> Benchmarks()
+{
+    vector<Benchmark> benchmarks;
+    for (int body = MERCURY; body < NOBJ; body++)
+        benchmarks.push_back({string("obj_cir/") + bodyNames[body], BenchObjCir, body, 20000});
+    benchmarks.push_back({"GetModifiedRiset/sun", BenchModifiedRiset, SUN, 200});
+    benchmarks.push_back({"GetModifiedRiset/moon", BenchModifiedRiset, MOON, 200});
+    benchmarks.push_back({"GetModifiedRiset/mars", BenchModifiedRiset, MARS, 200});
+    benchmarks.push_back({"FindAltXSun", BenchFindAltXSun, SUN, 500});
+    benchmarks.push_back({"GetSunDetails/1day", BenchSunDetails, 1, 100});
+    benchmarks.push_back({"GetSunDetails/7days", BenchSunDetails, 7, 20});
+    benchmarks.push_back({"GetAlmanac/1day", BenchAlmanac, 1, 100});
+    benchmarks.push_back({"GetAlmanac/365days", BenchAlmanac, 365, 5});
+    benchmarks.push_back({"GetSitePositions/moon/10000", BenchSitePositions, MOON, 50});
+    benchmarks.push_back({"GetSiteRisets/sun/10000", BenchSiteRisets, SUN, 5});
+    benchmarks.push_back({"GetSiteRisets/moon/10000", BenchSiteRisets, MOON, 5});
+    benchmarks.push_back({"GetSkyPositions/all/24h", BenchSkyPositions, 24, 50});
+    benchmarks.push_back({"FindMoonPhase", BenchFindMoonPhase, MOON, 1000});
+    benchmarks.push_back({"GetMoonPhaseEvents/365days", BenchMoonPhaseEvents, 365, 1000});
+    benchmarks.push_back({"GetRADECRiset", BenchRADECRiset, 0, 20000});
+    benchmarks.push_back({"GetStarRisets/10000", BenchStarRisets, 0, 50});
+    benchmarks.push_back({"TransformStars/10000", BenchTransformStars, 0, 50});
+    benchmarks.push_back({"GetSatellitePosition/leo", BenchSatellitePosition, 0, 20000});
+    benchmarks.push_back({"GetSatellitePosition/geo", BenchSatellitePosition, 1, 20000});
+    benchmarks.push_back({"GetNextSatellitePass/leo", BenchNextSatellitePass, 0, 200});
+    benchmarks.push_back({"GetNextSatellitePass/geo", BenchNextSatellitePass, 1, 20});
+    benchmarks.push_back({"GetSatellitePasses/serial", BenchSatellitePasses, 1, 5});
+    benchmarks.push_back({"GetSatellitePasses/threads", BenchSatellitePasses, 0, 5});
+    return benchmarks;
+}
+
+static BenchResult Run(const Benchmark &benchmark, double scale)
+{
+    int iterations = max(1, (int)(benchmark.iterations * scale));
+
+    /* once through first, for one-time setup such as the deltaT table */
+    benchmark.call(benchmark.body, -1);
+
+    evaluations = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        benchmark.call(benchmark.body, i);
+    auto end = chrono::steady_clock::now();
+
+    double ns = chrono::duration<double, nano>(end - start).count();
+    return {benchmark.name, iterations, ns / iterations, (double)evaluations / iterations};
+}
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    const char *filter = NULL;
+    double scale = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--json"))
+            json = true;
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+            filter = argv[++i];
+        else if (!strcmp(argv[i], "--scale") && i + 1 < argc)
+            scale = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--accuracy") && i + 1 < argc)
+            astro_setaccuracy(atoi(argv[++i]));
+        else
+        {
+            fprintf(stderr, "usage: %s [--json] [--filter text] [--scale factor] [--accuracy tier]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    vector<BenchResult> results;
+    for (const Benchmark &benchmark : Benchmarks())
+    {
+        if (filter && benchmark.name.find(filter) == string::npos)
+            continue;
+        BenchResult result = Run(benchmark, scale);
+        if (!json)
+            printf("%-28s %8d %14.1f ns/op %10.1f evals/op\n", result.name.c_str(), result.iterations, result.nsPerOp, result.evalsPerOp);
+        results.push_back(result);
+    }
+
+    if (json)
+    {
+        printf("{\n  \"input_time\": %.0f,\n  \"accuracy\": %d,\n  \"benchmarks\": [\n", BENCH_TIME, astro_accuracy());
+        for (size_t i = 0; i < results.size(); i++)
+            printf("    {\"name\": \"%s\", \"iterations\": %d, \"ns_per_op\": %.1f, \"evals_per_op\": %.2f}%s\n",
+                   results[i].name.c_str(), results[i].iterations, results[i].nsPerOp, results[i].evalsPerOp,
+                   i + 1 < results.size() ? "," : "");
+        printf("  ]\n}\n");
+    }
+    return 0;
+}
@@ -1,32 +1,221 @@
 #include <jni.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
+#include <mutex>
+#include <vector>
 
+#include "astro-jni.h"
 #include "astro_common.h"
 
+#define MODEL_PACKAGE "cc/meowssage/astroweather/SunMoon/Model/"
+#define POSITION_TYPE "L" MODEL_PACKAGE "AstroPosition;"
+
 namespace {
+    // global class references and method ids. classes the app does not have
+    // are left null
+    struct JNIReferences {
+        jclass dateCls;
+        jmethodID dateInitMethod;
+        jmethodID dateGetTimeMethod;
+        jclass arrayListCls;
+        jmethodID arrayListInitMethod;
+        jmethodID arrayListAddMethod;
+        jclass posCls;
+        jmethodID posInitMethod;
+        jclass risetCls;
+        jmethodID risetInitMethod;
+        jclass sunMoonCls;
+        jmethodID sunMoonInitMethod;
+        jclass starRisetCls;
+        jmethodID starRisetInitMethod;
+        jclass lpCls;
+        jmethodID lpInitMethod;
+        jclass statusCls;
+        jmethodID statusInitMethod;
+        jclass passCls;
+        jmethodID passInitMethod;
+        jclass stCls;
+        jmethodID stInitMethod;
+    };
+
+    JNIReferences references;
+    std::mutex referencesLock;
+    std::atomic<bool> referencesReady(false);
+
+    jclass findClass(JNIEnv *env, const char *name) {
+        jclass cls = env->FindClass(name);
+        if (!cls) {
+            env->ExceptionClear();
+            return nullptr;
+        }
+        auto global = (jclass)env->NewGlobalRef(cls);
+        env->DeleteLocalRef(cls);
+        return global;
+    }
+
+    jmethodID findMethod(JNIEnv *env, jclass cls, const char *name, const char *signature) {
+        if (!cls)
+            return nullptr;
+        jmethodID method = env->GetMethodID(cls, name, signature);
+        if (!method)
+            env->ExceptionClear();
+        return method;
+    }
+
+    // a copy of the references, looked up again under the lock until every
+    // one has been found: FindClass on a thread attached with
+    // AttachCurrentThread only sees the system class loader, so a lookup
+    // failing there is not final
+    JNIReferences getReferences(JNIEnv *env) {
+        if (referencesReady.load(std::memory_order_acquire))
+            return references;
+        std::lock_guard<std::mutex> lock(referencesLock);
+        JNIReferences &r = references;
+        if (referencesReady.load(std::memory_order_relaxed))
+            return r;
+        if (!r.dateCls)
+            r.dateCls = findClass(env, "java/util/Date");
+        if (!r.dateInitMethod)
+            r.dateInitMethod = findMethod(env, r.dateCls, "<init>", "(J)V");
+        if (!r.dateGetTimeMethod)
+            r.dateGetTimeMethod = findMethod(env, r.dateCls, "getTime", "()J");
+        if (!r.arrayListCls)
+            r.arrayListCls = findClass(env, "java/util/ArrayList");
+        if (!r.arrayListInitMethod)
+            r.arrayListInitMethod = findMethod(env, r.arrayListCls, "<init>", "(I)V");
+        if (!r.arrayListAddMethod)
+            r.arrayListAddMethod = findMethod(env, r.arrayListCls, "add", "(Ljava/lang/Object;)Z");
+        if (!r.posCls)
+            r.posCls = findClass(env, MODEL_PACKAGE "AstroPosition");
+        if (!r.posInitMethod)
+            r.posInitMethod = findMethod(env, r.posCls, "<init>", "(DDJ)V");
+        if (!r.risetCls)
+            r.risetCls = findClass(env, MODEL_PACKAGE "AstroRiset");
+        if (!r.risetInitMethod)
+            r.risetInitMethod = findMethod(env, r.risetCls, "<init>", "(" POSITION_TYPE POSITION_TYPE POSITION_TYPE POSITION_TYPE "Ljava/lang/String;)V");
+        if (!r.sunMoonCls)
+            r.sunMoonCls = findClass(env, MODEL_PACKAGE "SunMoonRiset");
+        if (!r.sunMoonInitMethod)
+            r.sunMoonInitMethod = findMethod(env, r.sunMoonCls, "<init>", "(L" MODEL_PACKAGE "AstroRiset;L" MODEL_PACKAGE "AstroRiset;)V");
+        if (!r.starRisetCls)
+            r.starRisetCls = findClass(env, MODEL_PACKAGE "StarRiset");
+        if (!r.starRisetInitMethod)
+            r.starRisetInitMethod = findMethod(env, r.starRisetCls, "<init>", "(" POSITION_TYPE POSITION_TYPE POSITION_TYPE POSITION_TYPE ")V");
+        if (!r.lpCls)
+            r.lpCls = findClass(env, MODEL_PACKAGE "LunarPhase");
+        if (!r.lpInitMethod)
+            r.lpInitMethod = findMethod(env, r.lpCls, "<init>", "(JJLjava/lang/String;DZ)V");
+        if (!r.statusCls)
+            r.statusCls = findClass(env, MODEL_PACKAGE "SatelliteStatus");
+        if (!r.statusInitMethod)
+            r.statusInitMethod = findMethod(env, r.statusCls, "<init>", "(DDD)V");
+        if (!r.passCls)
+            r.passCls = findClass(env, MODEL_PACKAGE "SatellitePass");
+        if (!r.passInitMethod)
+            r.passInitMethod = findMethod(env, r.passCls, "<init>", "(" POSITION_TYPE POSITION_TYPE POSITION_TYPE POSITION_TYPE POSITION_TYPE ")V");
+        if (!r.stCls)
+            r.stCls = findClass(env, MODEL_PACKAGE "SunTime");
+        if (!r.stInitMethod)
+            r.stInitMethod = findMethod(env, r.stCls, "<init>", "(DDI)V");
+        referencesReady.store(r.dateCls && r.dateInitMethod && r.dateGetTimeMethod &&
+                              r.arrayListCls && r.arrayListInitMethod && r.arrayListAddMethod &&
+                              r.posCls && r.posInitMethod && r.risetCls && r.risetInitMethod &&
+                              r.sunMoonCls && r.sunMoonInitMethod && r.starRisetCls && r.starRisetInitMethod &&
+                              r.lpCls && r.lpInitMethod && r.statusCls && r.statusInitMethod &&
+                              r.passCls && r.passInitMethod && r.stCls && r.stInitMethod,
+                              std::memory_order_release);
+        return r;
+    }
+
+    // NewObject of cls, or null with a NoClassDefFoundError pending when the
+    // class or its constructor was not found
+    jobject newObject(JNIEnv *env, jclass cls, jmethodID init, ...) {
+        if (!cls || !init) {
+            if (env->ExceptionCheck())
+                return nullptr;
+            jclass error = env->FindClass("java/lang/NoClassDefFoundError");
+            if (error)
+                env->ThrowNew(error, "astro model class not found");
+            return nullptr;
+        }
+        va_list args;
+        va_start(args, init);
+        jobject result = env->NewObjectV(cls, init, args);
+        va_end(args);
+        return result;
+    }
+
     jlong getTime(JNIEnv *env, jobject dateObject) {
-        jclass dateCls = env->FindClass("java/util/Date");
-        jmethodID getTimeMethod = env->GetMethodID(dateCls, "getTime", "()J");
-        jlong origTime = env->CallLongMethod(dateObject, getTimeMethod);
-        return origTime;
+        return env->CallLongMethod(dateObject, getReferences(env).dateGetTimeMethod);
     }
 
     jobject createDateObject(JNIEnv *env, jlong time) {
-        jclass dateCls = env->FindClass("java/util/Date");
-        jmethodID dateInitMethod =  env->GetMethodID(dateCls, "<init>", "(J)V");
-        return env->NewObject(dateCls, dateInitMethod, time);
+        const JNIReferences r = getReferences(env);
+        return newObject(env, r.dateCls, r.dateInitMethod, time);
+    }
+
+    jobject createPosition(JNIEnv *env, double el, double az, jlong time) {
+        const JNIReferences r = getReferences(env);
+        return newObject(env, r.posCls, r.posInitMethod, (jdouble)el, (jdouble)az, time);
     }
+
+    // times of a long[] of milliseconds since 1970, in seconds
+    std::vector<double> getTimes(JNIEnv *env, jlongArray times) {
+        if (!times)
+            return std::vector<double>();
+        jsize count = env->GetArrayLength(times);
+        std::vector<jlong> milliseconds(count);
+        env->GetLongArrayRegion(times, 0, count, milliseconds.data());
+        std::vector<double> seconds(count);
+        for (jsize i = 0; i < count; i++)
+            seconds[i] = milliseconds[i] / 1000.0;
+        return seconds;
+    }
+
+    std::vector<double> getDoubles(JNIEnv *env, jdoubleArray values) {
+        if (!values)
+            return std::vector<double>();
+        jsize count = env->GetArrayLength(values);
+        std::vector<double> result(count);
+        env->GetDoubleArrayRegion(values, 0, count, result.data());
+        return result;
+    }
+
+    jdoubleArray createDoubleArray(JNIEnv *env, const std::vector<double> &values) {
+        jdoubleArray array = env->NewDoubleArray((jsize)values.size());
+        if (array)
+            env->SetDoubleArrayRegion(array, 0, (jsize)values.size(), values.data());
+        return array;
+    }
+
+    // sites of a call, holding the arrays the grid points into
+    struct Sites {
+        std::vector<double> longitude, latitude, altitude;
+        SiteGrid grid;
+
+        Sites(JNIEnv *env, jdoubleArray longitudes, jdoubleArray latitudes, jdoubleArray altitudes)
+            : longitude(getDoubles(env, longitudes)), latitude(getDoubles(env, latitudes)), altitude(getDoubles(env, altitudes)) {
+            size_t count = std::min(longitude.size(), latitude.size());
+            altitude.resize(count, 0);
+            grid = { longitude.data(), latitude.data(), altitude.data(), (int)count };
+        }
+    };
+}
+
+void cacheJNIReferences(JNIEnv *env)
+{
+    getReferences(env);
 }
 
 jobject getRisetAtIndex(JNIEnv *env,
                            jdouble longitude, jdouble latitude, jdouble altitude,
                            jobject time, jint index, jboolean up) {
 
-    jclass posCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/AstroPosition");
-    jclass risetCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/AstroRiset");
-    jmethodID posInitMethod = env->GetMethodID(posCls, "<init>", "(DDJ)V");
-    jmethodID risetInitMethod = env->GetMethodID(risetCls, "<init>", "(Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Ljava/lang/String;)V");
+    const JNIReferences r = getReferences(env);
 
     jlong origTime = getTime(env, time);
 
@@ -39,14 +228,14 @@ jobject getRisetAtIndex(JNIEnv *env,
     jobject peak = nullptr;
     double el, az;
     int result = GetModifiedRiset(&now, (int)index, &riset, &el, &az, up == JNI_TRUE);
-    jobject current = env->NewObject(posCls, posInitMethod, (jdouble)el, (jdouble)az, origTime);
+    jobject current = createPosition(env, el, az, origTime);
     if (result == 0) {
-        rise = env->NewObject(posCls, posInitMethod, (jdouble)0, (jdouble)riset.rs_riseaz, (jlong)(EphemToEpochTime(riset.rs_risetm) * 1000));
-        set = env->NewObject(posCls, posInitMethod, (jdouble)0, (jdouble)riset.rs_setaz, (jlong)(EphemToEpochTime(riset.rs_settm) * 1000));
-        peak = env->NewObject(posCls, posInitMethod, (jdouble)riset.rs_tranalt, (jdouble)riset.rs_tranaz, (jlong)(EphemToEpochTime(riset.rs_trantm) * 1000));
+        rise = createPosition(env, 0, riset.rs_riseaz, (jlong)(EphemToEpochTime(riset.rs_risetm) * 1000));
+        set = createPosition(env, 0, riset.rs_setaz, (jlong)(EphemToEpochTime(riset.rs_settm) * 1000));
+        peak = createPosition(env, riset.rs_tranalt, riset.rs_tranaz, (jlong)(EphemToEpochTime(riset.rs_trantm) * 1000));
     }
 
-    return env->NewObject(risetCls, risetInitMethod, rise, set, peak, current, env->NewStringUTF(GetStarName(index)));
+    return newObject(env, r.risetCls, r.risetInitMethod, rise, set, peak, current, env->NewStringUTF(GetStarName(index)));
 }
 
 
@@ -71,39 +260,37 @@ jobject getSunAltTime(JNIEnv *env,
 jobject getRiset(JNIEnv *env,
                  jdouble longitude, jdouble latitude,
                  jdouble altitude, jobject time) {
-    jclass sunMoonCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/SunMoonRiset");
-    jmethodID sunMoonInitMethod = env->GetMethodID(sunMoonCls, "<init>", "(Lcc/meowssage/astroweather/SunMoon/Model/AstroRiset;Lcc/meowssage/astroweather/SunMoon/Model/AstroRiset;)V");
+    const JNIReferences r = getReferences(env);
 
     jobject sunriset = getRisetAtIndex(env, longitude, latitude, altitude, time, SUN, JNI_TRUE);
     jobject moonriset = getRisetAtIndex(env, longitude, latitude, altitude, time, MOON, JNI_TRUE);
 
-    return env->NewObject(sunMoonCls, sunMoonInitMethod, sunriset, moonriset);
+    return newObject(env, r.sunMoonCls, r.sunMoonInitMethod, sunriset, moonriset);
 }
 
 jobject getAllRiset(JNIEnv *env,
                     jdouble longitude, jdouble latitude, jdouble altitude,
                     jobject time) {
-    jclass arrayListClass = env->FindClass("java/util/ArrayList");
-    jmethodID construct = env->GetMethodID(arrayListClass, "<init>", "(I)V");
-    jobject result = env->NewObject(arrayListClass, construct, (jint)(MOON - MERCURY + 1));
-    jmethodID arrayListAdd = env->GetMethodID(arrayListClass, "add", "(Ljava/lang/Object;)Z");
+    const JNIReferences r = getReferences(env);
+    jobject result = newObject(env, r.arrayListCls, r.arrayListInitMethod, (jint)(MOON - MERCURY + 1));
+    if (!result)
+        return nullptr;
 
     for (int i = MERCURY; i <= MOON; ++i)
-        env->CallBooleanMethod(result, arrayListAdd, getRisetAtIndex(env, longitude, latitude, altitude, time, i, JNI_TRUE));
+        env->CallBooleanMethod(result, r.arrayListAddMethod, getRisetAtIndex(env, longitude, latitude, altitude, time, i, JNI_TRUE));
     return result;
 }
 
 jobject getLunarPhase(JNIEnv *env, jobject time) {
-    jclass lpCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/LunarPhase");
-    jmethodID lpInitMethod = env->GetMethodID(lpCls, "<init>", "(JJLjava/lang/String;DZ)V");
+    const JNIReferences r = getReferences(env);
 
     jlong mi = getTime(env, time);
 
     double now = (double)mi / 1000;
-    double pn = FindMoonPhase(now, M_PI * -2, 0);
-    double nn = FindMoonPhase(now, M_PI * 2, 0);
-    double nf = FindMoonPhase(now, M_PI * 2, M_PI);
-    double pnn = FindMoonPhase(pn, M_PI * 2, M_PI);
+    double pn = FindMoonPhaseEvent(now, MOON_PHASE_NEW, false);
+    double nn = FindMoonPhaseEvent(now, MOON_PHASE_NEW, true);
+    double nf = FindMoonPhaseEvent(now, MOON_PHASE_FULL, true);
+    double pnn = FindMoonPhaseEvent(pn, MOON_PHASE_FULL, true);
     double phase = CurrentMoonPhase(now);
     bool isFirstHalf = now <= pnn;
 
@@ -133,15 +320,12 @@ jobject getLunarPhase(JNIEnv *env, jobject time) {
         _name = "Full Moon";
     }
 
-    return env->NewObject(lpCls, lpInitMethod, (jlong)(nn * 1000), (jlong)(nf * 1000), env->NewStringUTF(_name), phase, isFirstHalf ? JNI_TRUE : JNI_FALSE);
+    return newObject(env, r.lpCls, r.lpInitMethod, (jlong)(nn * 1000), (jlong)(nf * 1000), env->NewStringUTF(_name), phase, isFirstHalf ? JNI_TRUE : JNI_FALSE);
 }
 
 jobject getStarRiset(JNIEnv *env, jdouble ra, jdouble dec, jdouble ra_pm, jdouble dec_pm, jdouble longitude, jdouble latitude, jdouble altitude, jobject time)
 {
-    jclass posCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/AstroPosition");
-    jclass risetCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/StarRiset");
-    jmethodID posInitMethod = env->GetMethodID(posCls, "<init>", "(DDJ)V");
-    jmethodID risetInitMethod = env->GetMethodID(risetCls, "<init>", "(Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;)V");
+    const JNIReferences r = getReferences(env);
 
     jlong origTime = getTime(env, time);
 
@@ -153,26 +337,47 @@ jobject getStarRiset(JNIEnv *env, jdouble ra, jdouble dec, jdouble ra_pm, jdoubl
     jobject rise = nullptr;
     jobject set = nullptr;
     jobject peak = nullptr;
-    jobject current = env->NewObject(posCls, posInitMethod, (jdouble)el_c, (jdouble)az_c, origTime);
+    jobject current = createPosition(env, el_c, az_c, origTime);
     if (status == 0)
     {
-        rise = env->NewObject(posCls, posInitMethod, (jdouble)0, (jdouble)az_r, (jlong)(riseTime * 1000));
-        set = env->NewObject(posCls, posInitMethod, (jdouble)0, (jdouble)az_s, (jlong)(setTime * 1000));
-        peak = env->NewObject(posCls, posInitMethod, (jdouble)el_t, (jdouble)az_t, (jlong)(transitTime * 1000));
+        rise = createPosition(env, 0, az_r, (jlong)(riseTime * 1000));
+        set = createPosition(env, 0, az_s, (jlong)(setTime * 1000));
+        peak = createPosition(env, el_t, az_t, (jlong)(transitTime * 1000));
     }
 
-    return env->NewObject(risetCls, risetInitMethod, rise, set, peak, current);
+    return newObject(env, r.starRisetCls, r.starRisetInitMethod, rise, set, peak, current);
 }
 
 jdouble getLST(JNIEnv *env, jdouble longitude, jobject time)
 {
-    jclass dateCls = env->FindClass("java/util/Date");
-    jmethodID getTimeMethod = env->GetMethodID(dateCls, "getTime", "()J");
-    jlong origTime = env->CallLongMethod(time, getTimeMethod);
+    jlong origTime = getTime(env, time);
 
     return (jdouble)GetLST(origTime / 1000.0, longitude);
 }
 
+namespace {
+    jobject createSatelliteStatus(JNIEnv *env, double sublng, double sublat, double elevation) {
+        const JNIReferences r = getReferences(env);
+        return newObject(env, r.statusCls, r.statusInitMethod, (jdouble)sublng, (jdouble)sublat, (jdouble)elevation);
+    }
+
+    jobject createSatellitePass(JNIEnv *env, const RiseSet &riset, const RiseSet &visibleRiset, double visibleRiseAlt, double visibleSetAlt) {
+        const JNIReferences r = getReferences(env);
+
+        jobject rise = createPosition(env, 0, riset.rs_riseaz, (jlong)(EphemToEpochTime(riset.rs_risetm) * 1000));
+        jobject set = createPosition(env, 0, riset.rs_setaz, (jlong)(EphemToEpochTime(riset.rs_settm) * 1000));
+        jobject peak = createPosition(env, riset.rs_tranalt, riset.rs_tranaz, (jlong)(EphemToEpochTime(riset.rs_trantm) * 1000));
+        jobject visibleRise = nullptr;
+        jobject visibleSet = nullptr;
+        if (visibleRiset.rs_flags == 0)
+        {
+            visibleRise = createPosition(env, visibleRiseAlt, visibleRiset.rs_riseaz, (jlong)(EphemToEpochTime(visibleRiset.rs_risetm) * 1000));
+            visibleSet = createPosition(env, visibleSetAlt, visibleRiset.rs_setaz, (jlong)(EphemToEpochTime(visibleRiset.rs_settm) * 1000));
+        }
+        return newObject(env, r.passCls, r.passInitMethod, rise, set, peak, visibleRise, visibleSet);
+    }
+}
+
 jobject getSatelliteStatus(JNIEnv *env,
                            jstring line0, jstring line1,
                            jstring line2, jobject time)
@@ -188,10 +393,7 @@ jobject getSatelliteStatus(JNIEnv *env,
     env->ReleaseStringUTFChars(line2, str2);
     if (!result)
         return nullptr;
-
-    jclass statusCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/SatelliteStatus");
-    jmethodID statusInitMethod = env->GetMethodID(statusCls, "<init>", "(DDD)V");
-    return env->NewObject(statusCls, statusInitMethod, (jdouble)sublng, (jdouble)sublat, (jdouble)elevation);
+    return createSatelliteStatus(env, sublng, sublat, elevation);
 }
 
 jobject getSatelliteNextRiset(JNIEnv *env,
@@ -201,12 +403,6 @@ jobject getSatelliteNextRiset(JNIEnv *env,
                               jdouble latitude,
                               jdouble altitude)
 {
-    jclass posCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/AstroPosition");
-    jclass risetCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/SatellitePass");
-    jmethodID posInitMethod = env->GetMethodID(posCls, "<init>", "(DDJ)V");
-    jmethodID risetInitMethod = env->GetMethodID(risetCls, "<init>",
-                                                 "(Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;Lcc/meowssage/astroweather/SunMoon/Model/AstroPosition;)V");
-
     jlong origTime = getTime(env, time);
     const char *str0 = env->GetStringUTFChars(line0, nullptr);
     const char *str1 = env->GetStringUTFChars(line1, nullptr);
@@ -220,17 +416,67 @@ jobject getSatelliteNextRiset(JNIEnv *env,
     env->ReleaseStringUTFChars(line2, str2);
     if (result != 0)
         return nullptr;
-    jobject rise = env->NewObject(posCls, posInitMethod, (jdouble)0, (jdouble)riset.rs_riseaz, (jlong)(EphemToEpochTime(riset.rs_risetm) * 1000));
-    jobject set = env->NewObject(posCls, posInitMethod, (jdouble)0, (jdouble)riset.rs_setaz, (jlong)(EphemToEpochTime(riset.rs_settm) * 1000));
-    jobject peak = env->NewObject(posCls, posInitMethod, (jdouble)riset.rs_tranalt, (jdouble)riset.rs_tranaz, (jlong)(EphemToEpochTime(riset.rs_trantm) * 1000));
-    jobject visibleRise = nullptr;
-    jobject visibleSet = nullptr;
-    if (visibleRiset.rs_flags == 0)
-    {
-        visibleRise = env->NewObject(posCls, posInitMethod, (jdouble)visibleRiseAlt, (jdouble)visibleRiset.rs_riseaz, (jlong)(EphemToEpochTime(visibleRiset.rs_risetm) * 1000));
-        visibleSet = env->NewObject(posCls, posInitMethod, (jdouble)visibleSetAlt, (jdouble)visibleRiset.rs_setaz, (jlong)(EphemToEpochTime(visibleRiset.rs_settm) * 1000));
-    }
-    return env->NewObject(risetCls, risetInitMethod, rise, set, peak, visibleRise, visibleSet);
+    return createSatellitePass(env, riset, visibleRiset, visibleRiseAlt, visibleSetAlt);
+}
+
+jlong createSatelliteHandle(JNIEnv *env, jstring line0, jstring line1, jstring line2)
+{
+    const char *str0 = env->GetStringUTFChars(line0, nullptr);
+    const char *str1 = env->GetStringUTFChars(line1, nullptr);
+    const char *str2 = env->GetStringUTFChars(line2, nullptr);
+    SatelliteHandle *satellite = CreateSatelliteHandle(str0, str1, str2);
+    env->ReleaseStringUTFChars(line0, str0);
+    env->ReleaseStringUTFChars(line1, str1);
+    env->ReleaseStringUTFChars(line2, str2);
+    return (jlong)(intptr_t)satellite;
+}
+
+void destroySatelliteHandle(jlong handle)
+{
+    DestroySatelliteHandle((SatelliteHandle *)(intptr_t)handle);
+}
+
+jobject getSatelliteStatus(JNIEnv *env, jlong handle, jobject time)
+{
+    auto satellite = (const SatelliteHandle *)(intptr_t)handle;
+    if (!satellite)
+        return nullptr;
+    jlong origTime = getTime(env, time);
+    double sublng, sublat, elevation;
+    if (!GetSatelliteStatus(satellite, origTime / 1000.0, &sublng, &sublat, &elevation))
+        return nullptr;
+    return createSatelliteStatus(env, sublng, sublat, elevation);
+}
+
+jobject getSatelliteNextRiset(JNIEnv *env, jlong handle, jobject time,
+                              jdouble longitude,
+                              jdouble latitude,
+                              jdouble altitude)
+{
+    auto satellite = (const SatelliteHandle *)(intptr_t)handle;
+    if (!satellite)
+        return nullptr;
+    jlong origTime = getTime(env, time);
+    RiseSet riset;
+    RiseSet visibleRiset;
+    double visibleRiseAlt, visibleSetAlt;
+    if (GetNextSatellitePass(satellite, origTime / 1000.0, (double)longitude, (double)latitude, (double)altitude, &riset, &visibleRiset, &visibleRiseAlt, &visibleSetAlt) != 0)
+        return nullptr;
+    return createSatellitePass(env, riset, visibleRiset, visibleRiseAlt, visibleSetAlt);
+}
+
+jobject getSatellitePosition(JNIEnv *env, jlong handle, jobject time,
+                             jdouble longitude, jdouble latitude,
+                             jdouble altitude)
+{
+    auto satellite = (const SatelliteHandle *)(intptr_t)handle;
+    if (!satellite)
+        return nullptr;
+    jlong origTime = getTime(env, time);
+    double el, az;
+    if (!GetSatellitePosition(satellite, longitude, latitude, altitude, origTime / 1000.0, &el, &az))
+        return nullptr;
+    return createPosition(env, el, az, origTime);
 }
 
 jobject getStarPosition(JNIEnv *env, jdouble ra, jdouble dec,
@@ -239,9 +485,6 @@ jobject getStarPosition(JNIEnv *env, jdouble ra, jdouble dec,
                         jdouble longitude, jdouble latitude,
                         jdouble altitude)
 {
-    jclass posCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/AstroPosition");
-    jmethodID posInitMethod = env->GetMethodID(posCls, "<init>", "(DDJ)V");
-
     Now now;
     jlong origTime = getTime(env, time);
     ConfigureObserver(longitude, latitude, altitude, (double)origTime / 1000, &now);
@@ -255,14 +498,11 @@ jobject getStarPosition(JNIEnv *env, jdouble ra, jdouble dec,
     obj.f_pmdec = (float)(dec_pm / 1000 / 3600 / 180 * M_PI / 365.25);
     obj_cir(&now, &obj);
 
-    return env->NewObject(posCls, posInitMethod, (jdouble)obj.f.co_alt, (jdouble)obj.f.co_az, origTime);
+    return createPosition(env, obj.f.co_alt, obj.f.co_az, origTime);
 }
 
 jobject getSolarSystemObjectPosition(JNIEnv *env, jint index, jobject time, jdouble longitude, jdouble latitude, jdouble altitude)
 {
-    jclass posCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/AstroPosition");
-    jmethodID posInitMethod = env->GetMethodID(posCls, "<init>", "(DDJ)V");
-
     Now now;
     jlong origTime = getTime(env, time);
     ConfigureObserver(longitude, latitude, altitude, (double)origTime / 1000, &now);
@@ -273,7 +513,7 @@ jobject getSolarSystemObjectPosition(JNIEnv *env, jint index, jobject time, jdou
     Obj obj = objs[index];
     obj_cir(&now, &obj);
 
-    return env->NewObject(posCls, posInitMethod, (jdouble)obj.any.co_alt, (jdouble)obj.any.co_az, origTime);
+    return createPosition(env, obj.any.co_alt, obj.any.co_az, origTime);
 }
 
 jobject getSatellitePosition(JNIEnv *env, jstring line0, jstring line1, jstring line2,  jobject time,
@@ -291,10 +531,7 @@ jobject getSatellitePosition(JNIEnv *env, jstring line0, jstring line1, jstring
     env->ReleaseStringUTFChars(line2, str2);
     if (!result)
         return nullptr;
-
-    jclass posCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/AstroPosition");
-    jmethodID posInitMethod = env->GetMethodID(posCls, "<init>", "(DDJ)V");
-    return env->NewObject(posCls, posInitMethod, (jdouble)el, (jdouble)az, origTime);
+    return createPosition(env, el, az, origTime);
 }
 
 jobject getSunTimes(JNIEnv *env,
@@ -302,18 +539,18 @@ jobject getSunTimes(JNIEnv *env,
                     jdouble altitude, jobject start_time,
                     jobject end_time)
 {
-    jclass arrayListClass = env->FindClass("java/util/ArrayList");
-    jmethodID construct = env->GetMethodID(arrayListClass, "<init>", "(I)V");
-    jclass stCls = env->FindClass("cc/meowssage/astroweather/SunMoon/Model/SunTime");
-    jmethodID stInitMethod = env->GetMethodID(stCls, "<init>", "(DDI)V");
+    const JNIReferences r = getReferences(env);
 
     auto periods = GetSunDetails(longitude, latitude, altitude, getTime(env, start_time) / 1000.0f, getTime(env, end_time) / 1000.0f);
 
-    jobject result = env->NewObject(arrayListClass, construct, (jint)(periods.size()));
-    jmethodID arrayListAdd = env->GetMethodID(arrayListClass, "add", "(Ljava/lang/Object;)Z");
+    jobject result = newObject(env, r.arrayListCls, r.arrayListInitMethod, (jint)(periods.size()));
+    if (!result)
+        return nullptr;
     for (auto period : periods)
     {
-        env->CallBooleanMethod(result, arrayListAdd, env->NewObject(stCls, stInitMethod, (jdouble)(period.start), (jdouble)(period.end), (jint)period.status));
+        jobject sunTime = newObject(env, r.stCls, r.stInitMethod, (jdouble)(period.start), (jdouble)(period.end), (jint)period.status);
+        env->CallBooleanMethod(result, r.arrayListAddMethod, sunTime);
+        env->DeleteLocalRef(sunTime);
     }
     return result;
 }
@@ -325,4 +562,385 @@ jobject getSolarSystemNextRiset(JNIEnv *env, jint index, jobject time,
                                 jboolean up)
 {
     return getRisetAtIndex(env, longitude, latitude, altitude, time, index, up);
-}
\ No newline at end of file
+}
+jdoubleArray getSolarSystemObjectPositions(JNIEnv *env, jint index, jlongArray times,
+                                           jdouble longitude, jdouble latitude,
+                                           jdouble altitude)
+{
+    std::vector<double> seconds = getTimes(env, times);
+    size_t count = seconds.size();
+    std::vector<double> result(2 * count);
+
+    int objectIndex = (int)index;
+    SkyPositions positions = {};
+    positions.alt = result.data();
+    positions.az = result.data() + count;
+    GetSkyPositions(&objectIndex, 1, seconds.data(), (int)count, longitude, latitude, altitude, &positions);
+    return createDoubleArray(env, result);
+}
+
+jdoubleArray getStarPositions(JNIEnv *env, jdouble ra, jdouble dec,
+                              jdouble ra_pm, jdouble dec_pm,
+                              jlongArray times,
+                              jdouble longitude, jdouble latitude,
+                              jdouble altitude)
+{
+    std::vector<double> seconds = getTimes(env, times);
+    size_t count = seconds.size();
+    std::vector<double> result(2 * count);
+
+    Now now;
+    ConfigureObserver(longitude, latitude, altitude, 0, &now);
+
+    Obj star;
+    star.o_type = FIXED;
+    star.f_RA = (float)radian(ra);
+    star.f_dec = (float)radian(dec);
+    star.f_epoch = J2000;
+    star.f_pmRA = (float)(ra_pm / 1000 / 3600 / 180 * M_PI / 365.25);
+    star.f_pmdec = (float)(dec_pm / 1000 / 3600 / 180 * M_PI / 365.25);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Obj obj = star;
+        now.n_mjd = EpochToEphemTime(seconds[i]);
+        obj_cir(&now, &obj);
+        result[i] = obj.f.co_alt;
+        result[count + i] = obj.f.co_az;
+    }
+    return createDoubleArray(env, result);
+}
+
+jlongArray getSolarSystemRisets(JNIEnv *env, jint index, jlongArray times,
+                                jdouble longitude, jdouble latitude,
+                                jdouble altitude)
+{
+    std::vector<double> seconds = getTimes(env, times);
+    size_t count = seconds.size();
+    std::vector<jlong> result(3 * count, 0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Now now;
+        ConfigureObserver(longitude, latitude, altitude, seconds[i], &now);
+
+        RiseSet riset;
+        double el, az;
+        if (GetModifiedRiset(&now, (int)index, &riset, &el, &az, true) != 0)
+            continue;
+        result[3 * i] = (jlong)(EphemToEpochTime(riset.rs_risetm) * 1000);
+        result[3 * i + 1] = (jlong)(EphemToEpochTime(riset.rs_settm) * 1000);
+        result[3 * i + 2] = (jlong)(EphemToEpochTime(riset.rs_trantm) * 1000);
+    }
+
+    jlongArray array = env->NewLongArray((jsize)result.size());
+    if (array)
+        env->SetLongArrayRegion(array, 0, (jsize)result.size(), result.data());
+    return array;
+}
+
+jdoubleArray getStarRisets(JNIEnv *env, jdoubleArray ra, jdoubleArray dec,
+                           jdoubleArray ra_pm, jdoubleArray dec_pm,
+                           jlong time, jdouble longitude, jdouble latitude)
+{
+    std::vector<double> raValues = getDoubles(env, ra);
+    std::vector<double> decValues = getDoubles(env, dec);
+    std::vector<double> raPmValues = getDoubles(env, ra_pm);
+    std::vector<double> decPmValues = getDoubles(env, dec_pm);
+    size_t count = std::min(raValues.size(), decValues.size());
+
+    StarCatalog stars = {};
+    stars.ra = raValues.data();
+    stars.dec = decValues.data();
+    stars.pmRA = raPmValues.size() >= count ? raPmValues.data() : nullptr;
+    stars.pmDec = decPmValues.size() >= count ? decPmValues.data() : nullptr;
+    stars.count = (int)count;
+
+    std::vector<double> result(10 * count);
+    std::vector<int> status(count);
+    StarRisets risets = {};
+    risets.riseTime = result.data();
+    risets.setTime = result.data() + count;
+    risets.transitTime = result.data() + 2 * count;
+    risets.riseAz = result.data() + 3 * count;
+    risets.setAz = result.data() + 4 * count;
+    risets.transitAz = result.data() + 5 * count;
+    risets.transitAlt = result.data() + 6 * count;
+    risets.currentAz = result.data() + 7 * count;
+    risets.currentAlt = result.data() + 8 * count;
+    risets.status = status.data();
+    GetStarRisets(&stars, longitude, latitude, time / 1000.0, &risets);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int k = 0; k < 3; k++)
+            result[k * count + i] *= 1000;
+        result[9 * count + i] = status[i];
+    }
+    return createDoubleArray(env, result);
+}
+
+jdoubleArray getStarCatalogPositions(JNIEnv *env, jdoubleArray ra, jdoubleArray dec,
+                                     jdoubleArray ra_pm, jdoubleArray dec_pm,
+                                     jlong time, jdouble longitude,
+                                     jdouble latitude, jdouble altitude)
+{
+    std::vector<double> raValues = getDoubles(env, ra);
+    std::vector<double> decValues = getDoubles(env, dec);
+    std::vector<double> raPmValues = getDoubles(env, ra_pm);
+    std::vector<double> decPmValues = getDoubles(env, dec_pm);
+    size_t count = std::min(raValues.size(), decValues.size());
+
+    StarCatalog stars = {};
+    stars.ra = raValues.data();
+    stars.dec = decValues.data();
+    stars.pmRA = raPmValues.size() >= count ? raPmValues.data() : nullptr;
+    stars.pmDec = decPmValues.size() >= count ? decPmValues.data() : nullptr;
+    stars.count = (int)count;
+
+    std::vector<double> result(2 * count);
+    SkyPositions positions = {};
+    positions.alt = result.data();
+    positions.az = result.data() + count;
+
+    StarTransform transform;
+    GetStarTransform(longitude, latitude, altitude, time / 1000.0, &transform);
+    TransformStars(&transform, &stars, &positions);
+    return createDoubleArray(env, result);
+}
+
+jlongArray getMoonPhaseEvents(JNIEnv *env, jlong start_time, jlong end_time)
+{
+    auto events = GetMoonPhaseEvents(start_time / 1000.0, end_time / 1000.0);
+    size_t count = events.size();
+    std::vector<jlong> result(2 * count);
+    for (size_t i = 0; i < count; i++)
+    {
+        result[i] = (jlong)(events[i].time * 1000);
+        result[count + i] = events[i].phase;
+    }
+
+    jlongArray array = env->NewLongArray((jsize)result.size());
+    if (array)
+        env->SetLongArrayRegion(array, 0, (jsize)result.size(), result.data());
+    return array;
+}
+
+jdoubleArray getAlmanac(JNIEnv *env, jdouble longitude, jdouble latitude, jdouble altitude, jlong start_time, jint days)
+{
+    auto almanac = GetAlmanac(longitude, latitude, altitude, start_time / 1000.0, days);
+    std::vector<double> result;
+    result.reserve(almanac.size() * 21);
+    for (const AlmanacDay &day : almanac)
+    {
+        const double times[] = {
+            day.start, day.sunRise, day.sunSet, day.sunTransit,
+            day.civilDawn, day.civilDusk, day.nauticalDawn, day.nauticalDusk,
+            day.astronomicalDawn, day.astronomicalDusk,
+            day.moonRise, day.moonSet, day.moonTransit,
+        };
+        for (double time : times)
+            result.push_back(time * 1000);
+        result.insert(result.end(), {
+            day.sunRiseAzimuth, day.sunSetAzimuth, day.sunTransitAzimuth, day.sunTransitAltitude,
+            day.moonRiseAzimuth, day.moonSetAzimuth, day.moonTransitAzimuth, day.moonTransitAltitude,
+        });
+    }
+    return createDoubleArray(env, result);
+}
+
+jdoubleArray getSitePositions(JNIEnv *env, jint index, jlong time, jdoubleArray longitudes,
+                              jdoubleArray latitudes, jdoubleArray altitudes)
+{
+    Sites sites(env, longitudes, latitudes, altitudes);
+    size_t count = sites.grid.count;
+
+    std::vector<double> result(2 * count);
+    SkyPositions positions = {};
+    positions.alt = result.data();
+    positions.az = result.data() + count;
+    GetSitePositions((int)index, time / 1000.0, &sites.grid, &positions);
+    return createDoubleArray(env, result);
+}
+
+jlongArray getSiteRisets(JNIEnv *env, jint index, jlong start_time, jlong end_time,
+                         jdoubleArray longitudes, jdoubleArray latitudes, jdoubleArray altitudes)
+{
+    Sites sites(env, longitudes, latitudes, altitudes);
+    size_t count = sites.grid.count;
+
+    std::vector<double> times(2 * count);
+    GetSiteRisets((int)index, start_time / 1000.0, end_time / 1000.0, &sites.grid, times.data(), times.data() + count);
+
+    std::vector<jlong> result(times.size());
+    for (size_t i = 0; i < times.size(); i++)
+        result[i] = (jlong)(times[i] * 1000);
+
+    jlongArray array = env->NewLongArray((jsize)result.size());
+    if (array)
+        env->SetLongArrayRegion(array, 0, (jsize)result.size(), result.data());
+    return array;
+}
+
+jlongArray getStats(JNIEnv *env)
+{
+    AstroStats stats;
+    stats_snapshot(&stats);
+
+    std::vector<jlong> result(stats.st_count, stats.st_count + NSTATCOUNTS);
+    for (int t = 0; t < NSTATTIMERS; t++)
+        result.insert(result.end(), stats.st_hist[t], stats.st_hist[t] + STAT_NBUCKETS);
+
+    jlongArray array = env->NewLongArray((jsize)result.size());
+    if (array)
+        env->SetLongArrayRegion(array, 0, (jsize)result.size(), result.data());
+    return array;
+}
+
+jobjectArray getStatNames(JNIEnv *env)
+{
+    jclass stringClass = env->FindClass("java/lang/String");
+    if (!stringClass)
+        return nullptr;
+    jobjectArray array = env->NewObjectArray(NSTATCOUNTS + NSTATTIMERS, stringClass, nullptr);
+    if (!array)
+        return nullptr;
+    for (int i = 0; i < NSTATCOUNTS + NSTATTIMERS; i++)
+    {
+        jstring name = env->NewStringUTF(i < NSTATCOUNTS ? stats_count_name(i) : stats_timer_name(i - NSTATCOUNTS));
+        env->SetObjectArrayElement(array, i, name);
+        env->DeleteLocalRef(name);
+    }
+    return array;
+}
+
+void resetStats()
+{
+    stats_reset();
+}
+
+jint setAccuracy(jint accuracy)
+{
+    return astro_setaccuracy(accuracy);
+}
+
+jdoubleArray getSatellitePositions(JNIEnv *env, jlong handle, jlongArray times,
+                                   jdouble longitude, jdouble latitude,
+                                   jdouble altitude)
+{
+    auto satellite = (const SatelliteHandle *)(intptr_t)handle;
+    if (!satellite)
+        return nullptr;
+    std::vector<double> seconds = getTimes(env, times);
+    size_t count = seconds.size();
+    std::vector<double> result(2 * count, NAN);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double el, az;
+        if (GetSatellitePosition(satellite, longitude, latitude, altitude, seconds[i], &el, &az))
+        {
+            result[i] = el;
+            result[count + i] = az;
+        }
+    }
+    return createDoubleArray(env, result);
+}
+
+namespace {
+    jdoubleArray nativeGetSolarSystemObjectPositions(JNIEnv *env, jclass, jint index, jlongArray times, jdouble longitude, jdouble latitude, jdouble altitude) {
+        return getSolarSystemObjectPositions(env, index, times, longitude, latitude, altitude);
+    }
+
+    jdoubleArray nativeGetStarPositions(JNIEnv *env, jclass, jdouble ra, jdouble dec, jdouble ra_pm, jdouble dec_pm, jlongArray times, jdouble longitude, jdouble latitude, jdouble altitude) {
+        return getStarPositions(env, ra, dec, ra_pm, dec_pm, times, longitude, latitude, altitude);
+    }
+
+    jlongArray nativeGetSolarSystemRisets(JNIEnv *env, jclass, jint index, jlongArray times, jdouble longitude, jdouble latitude, jdouble altitude) {
+        return getSolarSystemRisets(env, index, times, longitude, latitude, altitude);
+    }
+
+    jdoubleArray nativeGetStarRisets(JNIEnv *env, jclass, jdoubleArray ra, jdoubleArray dec, jdoubleArray ra_pm, jdoubleArray dec_pm, jlong time, jdouble longitude, jdouble latitude) {
+        return getStarRisets(env, ra, dec, ra_pm, dec_pm, time, longitude, latitude);
+    }
+
+    jdoubleArray nativeGetStarCatalogPositions(JNIEnv *env, jclass, jdoubleArray ra, jdoubleArray dec, jdoubleArray ra_pm, jdoubleArray dec_pm, jlong time, jdouble longitude, jdouble latitude, jdouble altitude) {
+        return getStarCatalogPositions(env, ra, dec, ra_pm, dec_pm, time, longitude, latitude, altitude);
+    }
+
+    jlongArray nativeGetMoonPhaseEvents(JNIEnv *env, jclass, jlong start_time, jlong end_time) {
+        return getMoonPhaseEvents(env, start_time, end_time);
+    }
+
+    jdoubleArray nativeGetAlmanac(JNIEnv *env, jclass, jdouble longitude, jdouble latitude, jdouble altitude, jlong start_time, jint days) {
+        return getAlmanac(env, longitude, latitude, altitude, start_time, days);
+    }
+
+    jdoubleArray nativeGetSitePositions(JNIEnv *env, jclass, jint index, jlong time, jdoubleArray longitudes, jdoubleArray latitudes, jdoubleArray altitudes) {
+        return getSitePositions(env, index, time, longitudes, latitudes, altitudes);
+    }
+
+    jlongArray nativeGetSiteRisets(JNIEnv *env, jclass, jint index, jlong start_time, jlong end_time, jdoubleArray longitudes, jdoubleArray latitudes, jdoubleArray altitudes) {
+        return getSiteRisets(env, index, start_time, end_time, longitudes, latitudes, altitudes);
+    }
+
+    jlongArray nativeGetStats(JNIEnv *env, jclass) {
+        return getStats(env);
+    }
+
+    jobjectArray nativeGetStatNames(JNIEnv *env, jclass) {
+        return getStatNames(env);
+    }
+
+    void nativeResetStats(JNIEnv *, jclass) {
+        resetStats();
+    }
+
+    jint nativeSetAccuracy(JNIEnv *, jclass, jint accuracy) {
+        return setAccuracy(accuracy);
+    }
+
+    jdoubleArray nativeGetSatellitePositions(JNIEnv *env, jclass, jlong handle, jlongArray times, jdouble longitude, jdouble latitude, jdouble altitude) {
+        return getSatellitePositions(env, handle, times, longitude, latitude, altitude);
+    }
+
+    const JNINativeMethod batchMethods[] = {
+        { "getSolarSystemObjectPositions", "(I[JDDD)[D", (void *)nativeGetSolarSystemObjectPositions },
+        { "getStarPositions", "(DDDD[JDDD)[D", (void *)nativeGetStarPositions },
+        { "getSolarSystemRisets", "(I[JDDD)[J", (void *)nativeGetSolarSystemRisets },
+        { "getStarRisets", "([D[D[D[DJDD)[D", (void *)nativeGetStarRisets },
+        { "getStarCatalogPositions", "([D[D[D[DJDDD)[D", (void *)nativeGetStarCatalogPositions },
+        { "getMoonPhaseEvents", "(JJ)[J", (void *)nativeGetMoonPhaseEvents },
+        { "getSatellitePositions", "(J[JDDD)[D", (void *)nativeGetSatellitePositions },
+        { "getAlmanac", "(DDDJI)[D", (void *)nativeGetAlmanac },
+        { "getSitePositions", "(IJ[D[D[D)[D", (void *)nativeGetSitePositions },
+        { "getSiteRisets", "(IJJ[D[D[D)[J", (void *)nativeGetSiteRisets },
+        { "getStats", "()[J", (void *)nativeGetStats },
+        { "getStatNames", "()[Ljava/lang/String;", (void *)nativeGetStatNames },
+        { "resetStats", "()V", (void *)nativeResetStats },
+        { "setAccuracy", "(I)I", (void *)nativeSetAccuracy },
+    };
+}
+
+jint registerBatchNatives(JNIEnv *env, const char *className)
+{
+    jclass cls = env->FindClass(className);
+    if (!cls)
+        return JNI_ERR;
+    jint result = env->RegisterNatives(cls, batchMethods, (jint)(sizeof(batchMethods) / sizeof(batchMethods[0])));
+    env->DeleteLocalRef(cls);
+    return result;
+}
+
+#ifdef ASTRO_JNI_CLASS
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *)
+{
+    JNIEnv *env;
+    if (vm->GetEnv((void **)&env, JNI_VERSION_1_6) != JNI_OK)
+        return JNI_ERR;
+    cacheJNIReferences(env);
+    if (registerBatchNatives(env, ASTRO_JNI_CLASS) != JNI_OK)
+        return JNI_ERR;
+    return JNI_VERSION_1_6;
+}
+#endif
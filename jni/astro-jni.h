@@ -3,6 +3,13 @@
 
 #include <jni.h>
 
+// looks up the model classes and method ids used below. call it from
+// JNI_OnLoad, where FindClass sees the app's class loader; otherwise calls
+// of the functions here look up whatever is still missing, and those
+// needing a class that is not found return null with NoClassDefFoundError
+// pending
+void cacheJNIReferences(JNIEnv *env);
+
 jobject getRiset(JNIEnv *env, jdouble longitude, jdouble latitude, jdouble altitude, jobject time);
 jobject getAllRiset(JNIEnv *env, jdouble longitude, jdouble latitude, jdouble altitude, jobject time);
 
@@ -26,6 +33,19 @@ jobject getSolarSystemObjectPosition(JNIEnv *env, jint index, jobject time, jdou
 jobject getSatellitePosition(JNIEnv *env, jstring line0, jstring line1, jstring line2,  jobject time,
                              jdouble longitude, jdouble latitude,
                              jdouble altitude);
+
+// handle is a SatelliteHandle pointer, 0 if the TLE could not be parsed.
+// keep one per satellite and release it with destroySatelliteHandle
+jlong createSatelliteHandle(JNIEnv *env, jstring line0, jstring line1, jstring line2);
+void destroySatelliteHandle(jlong handle);
+jobject getSatelliteStatus(JNIEnv *env, jlong handle, jobject time);
+jobject getSatelliteNextRiset(JNIEnv *env, jlong handle, jobject time,
+                              jdouble longitude,
+                              jdouble latitude,
+                              jdouble altitude);
+jobject getSatellitePosition(JNIEnv *env, jlong handle, jobject time,
+                             jdouble longitude, jdouble latitude,
+                             jdouble altitude);
 jobject getSunTimes(JNIEnv *env,
                     jdouble longitude, jdouble latitude,
                     jdouble altitude, jobject start_time,
@@ -35,4 +55,83 @@ jobject getSolarSystemNextRiset(JNIEnv *env, jint index, jobject time,
                                 jdouble latitude,
                                 jdouble altitude,
                                 jboolean up);
+
+// batch versions taking times as long[] of milliseconds since 1970, for
+// filling a chart in one call. positions come back as a double[] of all
+// the altitudes followed by all the azimuths, radians; NaN where the
+// satellite could not be propagated
+jdoubleArray getSolarSystemObjectPositions(JNIEnv *env, jint index, jlongArray times,
+                                           jdouble longitude, jdouble latitude,
+                                           jdouble altitude);
+jdoubleArray getStarPositions(JNIEnv *env, jdouble ra, jdouble dec,
+                              jdouble ra_pm, jdouble dec_pm,
+                              jlongArray times,
+                              jdouble longitude, jdouble latitude,
+                              jdouble altitude);
+jdoubleArray getSatellitePositions(JNIEnv *env, jlong handle, jlongArray times,
+                                   jdouble longitude, jdouble latitude,
+                                   jdouble altitude);
+// rise, set and transit time for each of times, milliseconds since 1970,
+// all 0 where the body does not rise or set
+jlongArray getSolarSystemRisets(JNIEnv *env, jint index, jlongArray times,
+                                jdouble longitude, jdouble latitude,
+                                jdouble altitude);
+// rise, set and transit of every star of a catalog, as GetStarRisets. ra and
+// dec in degrees, proper motions in milliarcseconds per year or null. comes
+// back as a double[] of ten blocks of one value per star: rise, set and
+// transit times in milliseconds since 1970, then rise, set and transit
+// azimuths, transit altitude, current azimuth and altitude in radians, and
+// last the riset() status
+jdoubleArray getStarRisets(JNIEnv *env, jdoubleArray ra, jdoubleArray dec,
+                           jdoubleArray ra_pm, jdoubleArray dec_pm,
+                           jlong time, jdouble longitude, jdouble latitude);
+// refracted altitude and azimuth of every star of a catalog at time, one
+// precession, nutation and aberration transform shared by all of them.
+// same arguments as getStarRisets, result as getStarPositions
+jdoubleArray getStarCatalogPositions(JNIEnv *env, jdoubleArray ra, jdoubleArray dec,
+                                     jdoubleArray ra_pm, jdoubleArray dec_pm,
+                                     jlong time, jdouble longitude,
+                                     jdouble latitude, jdouble altitude);
+// principal moon phases from start_time up to end_time, milliseconds since
+// 1970, as a long[] of all the times followed by their phases, 0 new, 1 first
+// quarter, 2 full and 3 last quarter
+jlongArray getMoonPhaseEvents(JNIEnv *env, jlong start_time, jlong end_time);
+// the sun, twilight and moon events of days days from start_time, each day 24
+// hours on from the one before, as a double[] of 21 values per day: the start
+// of the day, sunrise, sunset, sun transit, civil, nautical and astronomical
+// dawn and dusk, moonrise, moonset and moon transit in milliseconds since
+// 1970, 0 where the day has none, then the azimuths of sunrise, sunset and
+// sun transit, the sun's transit altitude and the same four of the moon, in
+// radians
+jdoubleArray getAlmanac(JNIEnv *env, jdouble longitude, jdouble latitude, jdouble altitude,
+                        jlong start_time, jint days);
+// refracted altitude and azimuth of body index at time from every site of a
+// grid of longitudes, latitudes, degrees, and altitudes, meters, as a double[]
+// of all the altitudes followed by all the azimuths, radians. the body is
+// evaluated once for all sites; a short altitudes array is taken as 0
+jdoubleArray getSitePositions(JNIEnv *env, jint index, jlong time, jdoubleArray longitudes,
+                              jdoubleArray latitudes, jdoubleArray altitudes);
+// first rise and set of body index within [start_time, end_time) from every
+// site, sites as getSitePositions, as a long[] of all the rise times followed
+// by all the set times, milliseconds since 1970, 0 where there is none
+jlongArray getSiteRisets(JNIEnv *env, jint index, jlong start_time, jlong end_time,
+                         jdoubleArray longitudes, jdoubleArray latitudes, jdoubleArray altitudes);
+// instrumentation of the library over all threads since the last resetStats,
+// all zero unless it was built with ASTRO_STATS. a long[] of the counters
+// followed by a log2 histogram of call times in nanoseconds for each timer,
+// STAT_NBUCKETS entries each; getStatNames gives the counter names and then
+// the timer names, in the same order
+jlongArray getStats(JNIEnv *env);
+jobjectArray getStatNames(JNIEnv *env);
+void resetStats();
+// accuracy tier of everything computed from then on, on every thread: 0 full,
+// 1 standard, about an arc second, 2 display, about an arc minute. returns
+// the tier it was
+jint setAccuracy(jint accuracy);
+
+// registers the batch functions above as the static natives of the same
+// names on className, eg "cc/meowssage/astroweather/SunMoon/Astro".
+// compiling with ASTRO_JNI_CLASS defined to such a name adds a JNI_OnLoad
+// that does this and cacheJNIReferences
+jint registerBatchNatives(JNIEnv *env, const char *className);
 #endif